@@ -0,0 +1,128 @@
+///@file evolution-benchmark.cpp
+///@brief Measures how fast evolve() runs on the CPU development backend, across population sizes and selection plans
+/*! Prints, for each population size and plan, the generations and genomes developed per second and the peak resident memory so far.
+ *  Rates include developing the initial population, and every run uses the same seed, so that changes to evolve() are compared on the same trajectory.
+ *  Usage: evolution-benchmark [threads] [development stages] [repeats]
+ */
+
+#include <evolution.hpp>
+#include <sys/resource.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+struct BenchmarkTargets{
+    float occupancy;
+    float heightToBaseRatio;
+};
+
+struct BenchmarkWeights{
+    float occupancyFactor;
+    float heightToBaseRatioFactor;
+
+    inline bool operator==(const BenchmarkWeights &rhs){
+        return occupancyFactor==rhs.occupancyFactor && heightToBaseRatioFactor==rhs.heightToBaseRatioFactor;
+    }
+    friend BenchmarkWeights operator+(BenchmarkWeights lhs, const BenchmarkWeights &rhs){
+        lhs.occupancyFactor += rhs.occupancyFactor;
+        lhs.heightToBaseRatioFactor += rhs.heightToBaseRatioFactor;
+        return lhs;
+    }
+    friend BenchmarkWeights operator*(BenchmarkWeights lhs, const int &rhs){
+        lhs.occupancyFactor *= rhs;
+        lhs.heightToBaseRatioFactor *= rhs;
+        return lhs;
+    }
+};
+
+float benchmarkFitness(Body *body, const BenchmarkTargets &targets, const BenchmarkWeights &weights){
+    int low[3] = {255, 255, 255};
+    int high[3] = {0, 0, 0};
+    for(uint64_t i=0;i<body->cellsNumber;++i){
+        for(int j=0;j<3;++j){
+            low[j]  = std::min<int>(low[j], body->cells[i].indices[j]);
+            high[j] = std::max<int>(high[j], body->cells[i].indices[j]);
+        }
+    }
+    float occupancy = body->cellsNumber/float((high[0] - low[0] + 1) * (high[1] - low[1] + 1) * (high[2] - low[2] + 1));
+    float heightToBaseRatio = (high[2] - low[2] + 1) / hypotf(high[0] - low[0] + 1, high[1] - low[1] + 1);
+    return weights.occupancyFactor * std::exp(-std::fabs(occupancy - targets.occupancy)) + weights.heightToBaseRatioFactor * std::exp(-std::fabs(heightToBaseRatio - targets.heightToBaseRatio));
+}
+
+///A selection plan mix, as the share of the population crossover and mutation generate, tournament selection generating the rest
+struct PlanMix{
+    const char *name;
+    float crossedOver;
+    float mutated;
+};
+
+///@returns The peak resident set size of the process so far, in MB
+long peakResidentMegabytes(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss/1024;
+}
+
+int main(int argc, char **argv){
+    int threads = argc > 1 ? std::atoi(argv[1]) : 0;
+    int developmentStages = argc > 2 ? std::atoi(argv[2]) : 16;
+    int repeats = argc > 3 ? std::atoi(argv[3]) : 5;
+    const int populationSizes[] = {64, 256, 1024};
+    const PlanMix mixes[] = {
+        {"selection", 0.125f, 0.125f},
+        {"crossover", 0.625f, 0.125f},
+        {"mutation",  0.125f, 0.625f}
+    };
+    //CpuBackend bodies can't outgrow one voxel per side and stage
+    uint64_t maxCells = uint64_t(2*developmentStages + 1)*(2*developmentStages + 1)*(2*developmentStages + 1);
+
+    std::printf("%-10s %-10s %12s %12s %10s\n", "population", "plan", "generations/s", "genomes/s", "peak RSS MB");
+    for(int populationSize : populationSizes){
+        std::vector<Genome_t> genomes(populationSize);
+        std::vector<Body> bodies(populationSize);
+        std::vector<std::vector<Cell>> cells(populationSize, std::vector<Cell>(maxCells));
+        for(int i=0;i<populationSize;++i){
+            bodies[i].cells = cells[i].data();
+        }
+        std::vector<float> fitness(populationSize);
+        for(const PlanMix &mix : mixes){
+            SelectionStage<BenchmarkWeights> stage;
+            stage.weights[0] = {1.f, 1.f};
+            stage.weights[1] = {0.f, 0.1f};
+            stage.repeats = repeats;
+            int crossedOver = mix.crossedOver*populationSize;
+            int mutated = mix.mutated*populationSize;
+            stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 4, populationSize - crossedOver - mutated);
+            stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, crossedOver);
+            stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, mutated);
+            SelectionPlan<BenchmarkWeights, BenchmarkTargets> plan{&stage, 1, true, {0.5f, 1.5f}};
+            plan.seed = 0x5EED;
+            for(int i=0;i<populationSize;++i){
+                RandomStream stream(plan.seed, StreamId{0, 0, 0, uint32_t(i)});
+                for(size_t b=0;b<sizeof(Genome_t);++b){
+                    ((uint8_t*) &genomes[i])[b] = stream.next();
+                }
+            }
+
+            EvolutionSettings settings;
+            settings.threads = threads;
+            settings.printProgress = false;
+            uint64_t developed = 0;
+            settings.statistics = [&developed](const GenerationStatistics &statistics){
+                developed += statistics.developed;
+            };
+            CpuBackend backend;
+            backend.threads = threads;
+            auto start = std::chrono::steady_clock::now();
+            {
+                Evolver<BenchmarkWeights, BenchmarkTargets, SparseBodyStorage, CpuBackend> evolver(settings, std::move(backend));
+                evolver.run(genomes.data(), populationSize, developmentStages, bodies.data(), fitness.data(), plan, benchmarkFitness);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("%-10d %-10s %12.2f %12.1f %10ld\n", populationSize, mix.name, repeats/seconds, developed/seconds, peakResidentMegabytes());
+            std::fflush(stdout);
+        }
+    }
+}
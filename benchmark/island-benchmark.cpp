@@ -0,0 +1,113 @@
+///@file island-benchmark.cpp
+///@brief Measures how evolveIslands() throughput scales with the number of islands, on the headless development backend
+/*! Runs the same plan on 1, 2, 4... islands up to the given number, each island evolving its own population of the given size,
+ *  and prints the genomes developed per second over all islands, as their generation statistics report them. The headless backend sleeps for the given latency on each development,
+ *  standing in for a GPU per island, so that scaling reflects what evolveIslands() itself costs rather than how many devices the machine has.
+ *  Usage: island-benchmark [islands] [population size] [latency in microseconds] [repeats]
+ */
+
+#include <evolution.hpp>
+#include <island-model.hpp>
+#include <sys/mman.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+struct BenchmarkTargets{
+    float occupancy;
+};
+
+struct BenchmarkWeights{
+    float occupancyFactor;
+
+    inline bool operator==(const BenchmarkWeights &rhs){
+        return occupancyFactor==rhs.occupancyFactor;
+    }
+    friend BenchmarkWeights operator+(BenchmarkWeights lhs, const BenchmarkWeights &rhs){
+        lhs.occupancyFactor += rhs.occupancyFactor;
+        return lhs;
+    }
+    friend BenchmarkWeights operator*(BenchmarkWeights lhs, const int &rhs){
+        lhs.occupancyFactor *= rhs;
+        return lhs;
+    }
+};
+
+float benchmarkFitness(Body *body, const BenchmarkTargets &targets, const BenchmarkWeights &weights){
+    return weights.occupancyFactor * std::exp(-std::fabs(body->cellsNumber/4096.f - targets.occupancy));
+}
+
+int main(int argc, char **argv){
+    int maxIslands = argc > 1 ? std::atoi(argv[1]) : 4;
+    int populationSize = argc > 2 ? std::atoi(argv[2]) : 64;
+    int latency = argc > 3 ? std::atoi(argv[3]) : 2000;
+    int repeats = argc > 4 ? std::atoi(argv[4]) : 10;
+    const int developmentStages = 16;
+
+    SelectionStage<BenchmarkWeights> stage;
+    stage.weights[0] = {1.f};
+    stage.weights[1] = {0.f};
+    stage.repeats = repeats;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 4, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize - populationSize/2 - populationSize/4);
+
+    //Each island stands in for a GPU of its own
+    auto makeBackend = [latency](int){
+        HeadlessBackend backend;
+        backend.latency = std::chrono::microseconds(latency);
+        return backend;
+    };
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    //Repeated genomes would come from the cache and hide the development latency
+    settings.genomeCacheBudget = 0;
+    //The islands report what they developed to a counter they share with this process
+    void *shared = mmap(nullptr, sizeof(std::atomic<uint64_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shared==MAP_FAILED){
+        return EXIT_FAILURE;
+    }
+    std::atomic<uint64_t> *developed = new(shared) std::atomic<uint64_t>(0);
+    settings.statistics = [developed](const GenerationStatistics &statistics){
+        developed->fetch_add(statistics.developed, std::memory_order_relaxed);
+    };
+
+    std::printf("%-8s %12s %12s\n", "islands", "genomes/s", "speedup");
+    double baseline = 0;
+    for(int islands=1;islands<=maxIslands;islands*=2){
+        std::vector<SelectionPlan<BenchmarkWeights, BenchmarkTargets>> plans(islands, SelectionPlan<BenchmarkWeights, BenchmarkTargets>{&stage, 1, true, {0.5f}});
+        std::vector<Genome_t> genomes(uint64_t(islands)*populationSize);
+        for(int i=0;i<islands;++i){
+            plans[i].seed = 0x5EED + i;
+            for(int k=0;k<populationSize;++k){
+                RandomStream stream(plans[i].seed, StreamId{0, 0, 0, uint32_t(k)});
+                for(size_t b=0;b<sizeof(Genome_t);++b){
+                    ((uint8_t*) &genomes[uint64_t(i)*populationSize + k])[b] = stream.next();
+                }
+            }
+        }
+        std::vector<float> fitness(genomes.size());
+        IslandSettings islandSettings;
+        islandSettings.islands = islands;
+        islandSettings.migrationInterval = 2;
+        islandSettings.migrants = 2;
+
+        developed->store(0);
+        auto start = std::chrono::steady_clock::now();
+        if(!evolveIslands<BenchmarkWeights, BenchmarkTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, fitness.data(), plans.data(), benchmarkFitness, islandSettings, settings, makeBackend)){
+            return EXIT_FAILURE;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = developed->load()/seconds;
+        if(islands==1){
+            baseline = rate;
+        }
+        std::printf("%-8d %12.1f %12.2f\n", islands, rate, rate/baseline);
+        std::fflush(stdout);
+    }
+    munmap(shared, sizeof(std::atomic<uint64_t>));
+}
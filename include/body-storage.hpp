@@ -0,0 +1,187 @@
+#pragma once
+///@file body-storage.hpp
+///@brief Compact storage for the voxel grids produced by birthBody
+/*! birthBody reads back a dense 256x256x256 grid, but a developed body only occupies a tiny fraction of it.
+ *  A body storage keeps one such grid in whatever form it sees fit; evolve() only talks to it through this interface:
+ *  @code
+ *  struct MyBodyStorage{
+ *      //Encodes a dense grid
+ *      void store(const uint8_t *grid);
+ *      //Writes the stored voxels into a grid whose other voxels are already 0
+ *      void expand(uint8_t *grid) const;
+ *      //Sets back to 0 the voxels expand() wrote, leaving the grid all zeroes
+ *      void erase(uint8_t *grid) const;
+ *      //Number of non-empty voxels
+ *      uint64_t occupiedCells() const;
+ *      //Bytes held by this storage
+ *      size_t memoryFootprint() const;
+ *  };
+ *  @endcode
+ *  Body storages also have to be default constructible and copy assignable.
+ */
+
+#include <evo-devo-gpu.hpp>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+///Number of voxels in the grid birthBody reads back
+constexpr uint32_t bodyGridVolume = 256*256*256;
+
+///Keeps the whole grid, as evolve() used to do. Its memory doesn't depend on the body at all
+struct DenseBodyStorage{
+    std::vector<uint8_t> grid;
+    uint64_t cells = 0;
+
+    void store(const uint8_t *source){
+        grid.assign(source, source + bodyGridVolume);
+        cells = 0;
+        for(uint32_t i=0;i<bodyGridVolume;++i){
+            cells += source[i]!=0;
+        }
+    }
+    void expand(uint8_t *destination) const{
+        if(!grid.empty()){
+            std::memcpy(destination, grid.data(), bodyGridVolume);
+        }
+    }
+    void erase(uint8_t *destination) const{
+        std::memset(destination, 0, bodyGridVolume);
+    }
+    uint64_t occupiedCells() const{
+        return cells;
+    }
+    size_t memoryFootprint() const{
+        return grid.capacity();
+    }
+};
+
+///Keeps only the runs of non-empty voxels of the grid, in the order they appear in memory, so its memory scales with the number of occupied cells
+struct SparseBodyStorage{
+    ///Pairs of (offset in the grid, length) of each run of non-empty voxels
+    std::vector<uint32_t> runs;
+    ///The values of the voxels of all runs, one after the other
+    std::vector<uint8_t> voxels;
+
+    void store(const uint8_t *grid){
+        runs.clear();
+        voxels.clear();
+        for(uint32_t i=0;i<bodyGridVolume;){
+            //Empty space is the common case, so it's skipped a word at a time
+            if(i%sizeof(uint64_t)==0){
+                uint64_t word;
+                std::memcpy(&word, grid + i, sizeof(word));
+                if(!word){
+                    i+=sizeof(uint64_t);
+                    continue;
+                }
+            }
+            if(!grid[i]){
+                ++i;
+                continue;
+            }
+            uint32_t start = i;
+            while(i<bodyGridVolume && grid[i]){
+                ++i;
+            }
+            runs.push_back(start);
+            runs.push_back(i - start);
+            voxels.insert(voxels.end(), grid + start, grid + i);
+        }
+        //Storages get reused for other bodies, so some slack is kept, but not so much that memory stops following the body's size
+        if(runs.capacity() > 2*runs.size()){
+            runs.shrink_to_fit();
+        }
+        if(voxels.capacity() > 2*voxels.size()){
+            voxels.shrink_to_fit();
+        }
+    }
+    void expand(uint8_t *grid) const{
+        const uint8_t *source = voxels.data();
+        for(size_t i=0;i<runs.size();i+=2){
+            std::memcpy(grid + runs[i], source, runs[i+1]);
+            source += runs[i+1];
+        }
+    }
+    void erase(uint8_t *grid) const{
+        for(size_t i=0;i<runs.size();i+=2){
+            std::memset(grid + runs[i], 0, runs[i+1]);
+        }
+    }
+    uint64_t occupiedCells() const{
+        return voxels.size();
+    }
+    size_t memoryFootprint() const{
+        return runs.capacity()*sizeof(uint32_t) + voxels.capacity();
+    }
+};
+
+/*!
+ * @brief   Calls isolateBody on a body kept in a body storage
+ * @param[out]  body    Has to have room for at least storage.occupiedCells() cells
+ * @param[in]   storage The body to isolate
+ * @param[in]   grid    A 256*256*256 grid of zeroes, which will be all zeroes again when the function returns
+ */
+template<class BodyStorage>
+void isolateBody(Body *body, const BodyStorage &storage, uint8_t *grid){
+    storage.expand(grid);
+    isolateBody(body, grid);
+    storage.erase(grid);
+}
+
+///The grid and Body evolve() needs to isolate bodies, sized after the biggest body seen rather than after the whole grid
+///@note Each thread needs its own
+struct BodyScratch{
+    Body body;
+    uint64_t capacity;
+
+    BodyScratch(){
+        grid = nullptr;
+        body.cells = nullptr;
+        body.cellsNumber = 0;
+        capacity = 0;
+    }
+    ~BodyScratch(){
+        delete[] grid;
+        delete[] body.cells;
+    }
+    BodyScratch(const BodyScratch&) = delete;
+    BodyScratch& operator=(const BodyScratch&) = delete;
+
+    ///@returns The isolated body, valid until the next call
+    template<class BodyStorage>
+    Body* isolate(const BodyStorage &storage){
+        reserve(storage.occupiedCells());
+        isolateBody(&body, storage, zeroedGrid());
+        return &body;
+    }
+    ///@returns A 256*256*256 grid of zeroes, allocated on first use, that has to be all zeroes again once the caller is done with it
+    uint8_t* zeroedGrid(){
+        if(!grid){
+            grid = new uint8_t[bodyGridVolume]();
+        }
+        return grid;
+    }
+    /*!
+     * @brief   Isolates a body straight from a dense grid, such as the one birthBody has just written
+     * @param[in]   source          The grid to isolate the body from
+     * @param[in]   occupiedCells   The number of non-empty voxels in source
+     * @returns The isolated body, valid until the next call
+     */
+    Body* isolateGrid(uint8_t *source, uint64_t occupiedCells){
+        reserve(occupiedCells);
+        isolateBody(&body, source);
+        return &body;
+    }
+
+private:
+    uint8_t *grid;
+
+    void reserve(uint64_t cells){
+        if(cells > capacity){
+            delete[] body.cells;
+            capacity = cells;
+            body.cells = new Cell[capacity];
+        }
+    }
+};
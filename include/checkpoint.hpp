@@ -0,0 +1,303 @@
+#pragma once
+///@file checkpoint.hpp
+///@brief Saving a running selection plan to disk, and reading it back to resume it
+/*! A checkpoint file is laid out as follows, all values in the machine's byte order:
+ *  | Field                         | Type                          |
+ *  |-------------------------------|-------------------------------|
+ *  | magic, "EVOCKPT"              | char[8]                       |
+ *  | checkpointVersion             | uint32_t                      |
+ *  | flags, 1 if bodies are saved  | uint32_t                      |
+ *  | sizeof(Genome_t)              | uint32_t                      |
+ *  | sizeof(W)                     | uint32_t                      |
+ *  | population size               | int32_t                       |
+ *  | stage                         | int32_t                       |
+ *  | repeat                        | int32_t                       |
+ *  | weightsVersion                | uint64_t                      |
+ *  | previousWeights               | W                             |
+ *  | seed                          | uint64_t                      |
+ *  | planFingerprint               | uint64_t                      |
+ *  | genomes                       | Genome_t[population size]     |
+ *  | fitness                       | float[population size]        |
+ *  Followed, if bodies are saved, by each body as the uint64_t number of its runs, the uint64_t number of its voxels, and then SparseBodyStorage::runs and SparseBodyStorage::voxels.
+ */
+
+#include <evo-devo-gpu.hpp>
+#include <body-storage.hpp>
+#include <selection-plan.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+///The version of the checkpoint format written by writeCheckpoint
+constexpr uint32_t checkpointVersion = 3;
+
+///Everything evolve() needs to continue a selection plan
+template<class W>
+struct Checkpoint{
+    ///The stage and repeat to run next
+    int stage = 0;
+    int repeat = 0;
+    ///The weights the fitnesses were computed with
+    W previousWeights;
+    ///How many times the weights had changed
+    uint64_t weightsVersion = 0;
+    ///The seed the run draws its random numbers with, see random-streams.hpp. Together with stage and repeat, this is all the random state there is
+    uint64_t seed = 0;
+    ///The planFingerprint() of the plan that ran up to stage and repeat
+    uint64_t planFingerprint = 0;
+    std::vector<Genome_t> genomes;
+    std::vector<float> fitness;
+    ///Either empty, in which case bodies are developed again from genomes, or one per genome
+    std::vector<SparseBodyStorage> bodies;
+};
+
+/*!
+ * @brief   Hashes what a selection plan does up to stage and repeat, so that a checkpoint is only resumed by the plan that wrote it
+ * Covers the settings the whole plan shares and each stage run so far, with its repeats if it's over, and its weights and substages.
+ * Stages still to come aren't covered, so a plan can be lengthened before resuming it.
+ * @returns The 64 bits FNV-1a hash of those settings
+ */
+template<class W, class T>
+uint64_t planFingerprint(const SelectionPlan<W, T> &plan, int stage, int repeat){
+    static_assert(std::is_trivially_copyable<W>::value, "Weights are hashed as raw bytes");
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void *data, size_t size){
+        for(size_t i=0;i<size;++i){
+            hash = (hash ^ ((const uint8_t*) data)[i])*1099511628211ull;
+        }
+    };
+    int32_t settings[3] = {plan.maximizeFitness, plan.mode, plan.mode==STEADY_STATE ? plan.evaluationsPerRepeat : 0};
+    add(settings, sizeof(settings));
+    add(&plan.seed, sizeof(plan.seed));
+    //The stage a checkpoint points into has run too, unless it points at its start
+    int run = repeat > 0 ? stage + 1 : stage;
+    for(int i=0;i<run && i<plan.number;++i){
+        const SelectionStage<W> &current = plan.stages[i];
+        int32_t repeats = i < stage ? current.repeats : -1;
+        add(&repeats, sizeof(repeats));
+        add(current.weights, sizeof(current.weights));
+        for(auto &substage : current.substages){
+            int32_t description[2] = {substage.type, substage.individuals};
+            add(description, sizeof(description));
+            add(&substage.param, sizeof(substage.param));
+        }
+    }
+    return hash;
+}
+
+///Converts a body to the layout checkpoints save bodies in
+inline void toSparseBody(const SparseBodyStorage &body, SparseBodyStorage *sparse, BodyScratch*){
+    *sparse = body;
+}
+///Converts a body to the layout checkpoints save bodies in
+template<class BodyStorage>
+void toSparseBody(const BodyStorage &body, SparseBodyStorage *sparse, BodyScratch *scratch){
+    uint8_t *grid = scratch->zeroedGrid();
+    body.expand(grid);
+    sparse->store(grid);
+    body.erase(grid);
+}
+
+///@returns Whether what was written to the file or directory at path could be made to survive a crash
+inline bool syncPath(const std::string &path, int flags){
+    int fd = open(path.c_str(), flags);
+    if(fd < 0){
+        return false;
+    }
+    bool synced = fsync(fd)==0;
+    return close(fd)==0 && synced;
+}
+
+///@returns Whether the directory holding path could be synced, so that a file created or renamed there survives a crash
+inline bool syncDirectoryOf(const std::string &path){
+    size_t slash = path.rfind('/');
+    return syncPath(slash==std::string::npos ? "." : slash==0 ? "/" : path.substr(0, slash), O_RDONLY | O_DIRECTORY);
+}
+
+/*!
+ * @brief   Writes a checkpoint file, replacing path only once the whole file has been written
+ * The file is synced before it replaces path, and its directory after, so that a crash leaves either the previous checkpoint or this one, but never an empty or partial file.
+ * @returns Whether the file could be written
+ */
+template<class W>
+bool writeCheckpoint(const std::string &path, const Checkpoint<W> &checkpoint){
+    static_assert(std::is_trivially_copyable<W>::value, "Checkpoints save the weights as raw bytes");
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        auto put = [&file](const void *data, size_t size){file.write((const char*) data, size);};
+        int32_t populationSize = checkpoint.genomes.size();
+        uint32_t header[4] = {checkpointVersion, !checkpoint.bodies.empty(), sizeof(Genome_t), sizeof(W)};
+        int32_t cursor[3] = {populationSize, checkpoint.stage, checkpoint.repeat};
+        put("EVOCKPT", 8);
+        put(header, sizeof(header));
+        put(cursor, sizeof(cursor));
+        put(&checkpoint.weightsVersion, sizeof(checkpoint.weightsVersion));
+        put(&checkpoint.previousWeights, sizeof(W));
+        put(&checkpoint.seed, sizeof(checkpoint.seed));
+        put(&checkpoint.planFingerprint, sizeof(checkpoint.planFingerprint));
+        put(checkpoint.genomes.data(), populationSize*sizeof(Genome_t));
+        put(checkpoint.fitness.data(), populationSize*sizeof(float));
+        for(auto &body : checkpoint.bodies){
+            uint64_t sizes[2] = {body.runs.size(), body.voxels.size()};
+            put(sizes, sizeof(sizes));
+            put(body.runs.data(), sizes[0]*sizeof(uint32_t));
+            put(body.voxels.data(), sizes[1]);
+        }
+        file.flush();
+        if(!file){
+            return false;
+        }
+    }
+    if(!syncPath(temporaryPath, O_WRONLY) || std::rename(temporaryPath.c_str(), path.c_str())){
+        return false;
+    }
+    return syncDirectoryOf(path);
+}
+
+/*!
+ * @brief   Reads a checkpoint file written by writeCheckpoint
+ * Sizes read from the file are checked against populationSize and against what the file holds before anything is allocated, so a corrupt file is rejected rather than exhausting memory.
+ * @param[in]   populationSize  How many individuals the checkpoint has to hold, or -1 for any number
+ * @returns Whether the file could be read, holds populationSize individuals, and was written with this checkpointVersion, Genome_t and W
+ */
+template<class W>
+bool readCheckpoint(const std::string &path, Checkpoint<W> *checkpoint, int populationSize = -1){
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file){
+        return false;
+    }
+    const uint64_t fileSize = file.tellg();
+    file.seekg(0);
+    auto get = [&file](void *data, size_t size){return bool(file.read((char*) data, size));};
+    //How many bytes are left to read
+    auto remaining = [&file, fileSize]{return fileSize - uint64_t(file.tellg());};
+    char magic[8];
+    uint32_t header[4];
+    int32_t cursor[3];
+    if(!get(magic, sizeof(magic)) || std::memcmp(magic, "EVOCKPT", sizeof(magic)) || !get(header, sizeof(header))){
+        return false;
+    }
+    if(header[0]!=checkpointVersion || header[2]!=sizeof(Genome_t) || header[3]!=sizeof(W)){
+        return false;
+    }
+    if(!get(cursor, sizeof(cursor)) || cursor[0]<0 || (populationSize>=0 && cursor[0]!=populationSize) || !get(&checkpoint->weightsVersion, sizeof(uint64_t)) || !get(&checkpoint->previousWeights, sizeof(W)) || !get(&checkpoint->seed, sizeof(uint64_t)) || !get(&checkpoint->planFingerprint, sizeof(uint64_t))){
+        return false;
+    }
+    //Each body takes at least its two sizes
+    const uint64_t individualSize = sizeof(Genome_t) + sizeof(float) + (header[1] ? 2*sizeof(uint64_t) : 0);
+    if(uint64_t(cursor[0])*individualSize > remaining()){
+        return false;
+    }
+    checkpoint->stage = cursor[1];
+    checkpoint->repeat = cursor[2];
+    checkpoint->genomes.resize(cursor[0]);
+    checkpoint->fitness.resize(cursor[0]);
+    if(!get(checkpoint->genomes.data(), cursor[0]*sizeof(Genome_t)) || !get(checkpoint->fitness.data(), cursor[0]*sizeof(float))){
+        return false;
+    }
+    checkpoint->bodies.clear();
+    if(header[1]){
+        checkpoint->bodies.resize(cursor[0]);
+        for(auto &body : checkpoint->bodies){
+            uint64_t sizes[2];
+            if(!get(sizes, sizeof(sizes)) || sizes[0]%2 || sizes[0] > bodyGridVolume || sizes[1] > bodyGridVolume || sizes[0]*sizeof(uint32_t) + sizes[1] > remaining()){
+                return false;
+            }
+            body.runs.resize(sizes[0]);
+            body.voxels.resize(sizes[1]);
+            if(!get(body.runs.data(), sizes[0]*sizeof(uint32_t)) || !get(body.voxels.data(), sizes[1])){
+                return false;
+            }
+            uint64_t runVoxels = 0;
+            for(size_t i=0;i<body.runs.size();i+=2){
+                if(uint64_t(body.runs[i]) + body.runs[i+1] > bodyGridVolume){
+                    return false;
+                }
+                runVoxels += body.runs[i+1];
+            }
+            if(runVoxels!=sizes[1]){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ * @brief   Writes checkpoints on a background thread, so that the generation loop doesn't wait for the disk
+ * At most one checkpoint waits to be written: submitting another one while the previous is still waiting replaces it.
+ */
+template<class W>
+class CheckpointWriter{
+public:
+    explicit CheckpointWriter(std::string path) : path(std::move(path)){
+        writer = std::thread(&CheckpointWriter::write, this);
+    }
+    ///Finishes writing the last checkpoint submitted
+    ~CheckpointWriter(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        submitted.notify_one();
+        writer.join();
+    }
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    /*!
+     * @param[in]   checkpoint  The checkpoint to write
+     * @param[in]   complete    Called on the writer thread before writing, to fill in the parts of checkpoint that are expensive to copy. May be empty
+     */
+    void submit(Checkpoint<W> checkpoint, std::function<void(Checkpoint<W>*)> complete){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.reset(new Checkpoint<W>(std::move(checkpoint)));
+            pendingComplete = std::move(complete);
+        }
+        submitted.notify_one();
+    }
+
+private:
+    void write(){
+        std::unique_lock<std::mutex> lock(mutex);
+        for(;;){
+            submitted.wait(lock, [this]{return stopping || pending;});
+            if(!pending){
+                return;
+            }
+            std::unique_ptr<Checkpoint<W>> checkpoint = std::move(pending);
+            std::function<void(Checkpoint<W>*)> complete = std::move(pendingComplete);
+            pendingComplete = nullptr;
+            lock.unlock();
+            if(complete){
+                complete(checkpoint.get());
+            }
+            if(!writeCheckpoint(path, *checkpoint)){
+                std::cerr<<"Couldn't write checkpoint "<<path<<std::endl;
+            }
+            lock.lock();
+        }
+    }
+
+    std::string path;
+    std::unique_ptr<Checkpoint<W>> pending;
+    std::function<void(Checkpoint<W>*)> pendingComplete;
+    std::mutex mutex;
+    std::condition_variable submitted;
+    bool stopping = false;
+    std::thread writer;
+};
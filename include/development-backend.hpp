@@ -0,0 +1,214 @@
+#pragma once
+///@file development-backend.hpp
+///@brief The ways evolve() can turn a genome into a birthed grid
+/*! A development backend wraps the four steps evo-devo-gpu splits development into:
+ *  @code
+ *  struct MyBackend{
+ *      //Called once, on the thread that will call all other methods. Returns false on failure
+ *      bool initialize();
+ *      void load(Genome_t *genome);
+ *      void develop(int developmentStages);
+ *      //Writes the developed body into a 256*256*256 grid
+ *      void birth(uint8_t *grid);
+ *      void release();
+ *  };
+ *  @endcode
+ */
+
+#include <evo-devo-gpu.hpp>
+#include <body-storage.hpp>
+#include <worker-pool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+///Develops genomes with evo-devo-gpu, on the OpenGL 4.5 context it creates
+struct OpenGLBackend{
+    OpenGLHandles handles;
+
+    bool initialize(){
+        return initializeOpenGLHandles(&handles);
+    }
+    void load(Genome_t *genome){
+        loadGenome(&handles, genome);
+    }
+    void develop(int developmentStages){
+        developBody(&handles, developmentStages);
+    }
+    void birth(uint8_t *grid){
+        birthBody(grid);
+    }
+    void release(){
+        deleteHandles(&handles);
+    }
+};
+
+///Stands in for evo-devo-gpu on machines without a GPU: grows a block shaped after a hash of the genome, taking optionally as long as a real development would
+///@note The bodies have nothing to do with what the genome would develop into, this only exists to exercise evolve() itself
+struct HeadlessBackend{
+    ///How long each develop() call blocks, to simulate the time spent on the GPU
+    std::chrono::microseconds latency{0};
+    uint64_t hash = 0;
+    int stages = 0;
+
+    bool initialize(){
+        return true;
+    }
+    void load(Genome_t *genome){
+        //FNV-1a
+        hash = 14695981039346656037ull;
+        const uint8_t *bytes = (const uint8_t*) genome;
+        for(size_t i=0;i<sizeof(Genome_t);++i){
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+    void develop(int developmentStages){
+        stages = developmentStages;
+        if(latency.count()){
+            std::this_thread::sleep_for(latency);
+        }
+    }
+    void birth(uint8_t *grid){
+        std::memset(grid, 0, bodyGridVolume);
+        int growth = stages < 64 ? stages : 64;
+        int halfSides[3];
+        for(int i=0;i<3;++i){
+            halfSides[i] = 1 + (hash >> (8*i))%(growth + 1);
+        }
+        for(int z=128-halfSides[2];z<128+halfSides[2];++z){
+            for(int y=128-halfSides[1];y<128+halfSides[1];++y){
+                for(int x=128-halfSides[0];x<128+halfSides[0];++x){
+                    grid[x + 256*y + 256*256*z] = 1 + (hash >> 24 ^ x ^ y ^ z)%stemCellsTypes;
+                }
+            }
+        }
+    }
+    void release(){}
+};
+
+/*!
+ * @brief   Develops genomes on the CPU with a cellular automaton, so that evolve() can be run and benchmarked on machines without a GPU
+ * Development starts from a single cell of the first stem cell type in the middle of the grid. At each stage, every empty voxel next to a cell may be colonized by it:
+ * the genome decides, for each stem cell type and each of the 6 directions, how likely that is and which type the new cell gets.
+ * Stages are double buffered and split by z slices between threads, and only the bounding box of the body grown so far is visited, which grows by at most one voxel per side and stage.
+ * @note    Like HeadlessBackend, this isn't what evo-devo-gpu would develop, but bodies do depend on the whole genome and cost time proportional to their volume
+ */
+struct CpuBackend{
+    ///How many threads develop each genome, 0 picks one per hardware thread
+    int threads = 0;
+
+    bool initialize(){
+        pool.reset(new WorkerPool(threads));
+        grids[0].reset(new uint8_t[bodyGridVolume]());
+        grids[1].reset(new uint8_t[bodyGridVolume]());
+        return true;
+    }
+    void load(Genome_t *genome){
+        const uint8_t *bytes = (const uint8_t*) genome;
+        for(int t=0;t<stemCellsTypes;++t){
+            for(int d=0;d<6;++d){
+                spreadThresholds[t][d] = bytes[(12*t + d)%sizeof(Genome_t)];
+                childTypes[t][d] = 1 + bytes[(12*t + 6 + d)%sizeof(Genome_t)]%stemCellsTypes;
+            }
+        }
+        //Only the previous body's bounding box has anything to clear, in both grids since the back one holds its previous stage
+        forEachSlice([this](int z){
+            for(int y=low[1];y<=high[1];++y){
+                std::memset(grids[0].get() + index(low[0], y, z), 0, high[0] - low[0] + 1);
+                std::memset(grids[1].get() + index(low[0], y, z), 0, high[0] - low[0] + 1);
+            }
+        });
+        for(int i=0;i<3;++i){
+            low[i] = high[i] = 128;
+        }
+        grids[current][index(128, 128, 128)] = 1;
+    }
+    void develop(int developmentStages){
+        for(int stage=0;stage<developmentStages;++stage){
+            int grownLow[3], grownHigh[3];
+            for(int i=0;i<3;++i){
+                grownLow[i]  = std::max(low[i] - 1, 1);
+                grownHigh[i] = std::min(high[i] + 1, 254);
+            }
+            const uint8_t *from = grids[current].get();
+            uint8_t *to = grids[1 - current].get();
+            //Every voxel the next stage can read is written: the grown box, and the empty border around it
+            pool->parallelFor(grownHigh[2] - grownLow[2] + 3, [&](int slice, int){
+                int z = grownLow[2] - 1 + slice;
+                for(int y=grownLow[1]-1;y<=grownHigh[1]+1;++y){
+                    if(z<grownLow[2] || z>grownHigh[2] || y<grownLow[1] || y>grownHigh[1]){
+                        std::memset(to + index(grownLow[0] - 1, y, z), 0, grownHigh[0] - grownLow[0] + 3);
+                        continue;
+                    }
+                    to[index(grownLow[0] - 1, y, z)] = 0;
+                    for(int x=grownLow[0];x<=grownHigh[0];++x){
+                        to[index(x, y, z)] = grow(from, x, y, z, stage);
+                    }
+                    to[index(grownHigh[0] + 1, y, z)] = 0;
+                }
+            });
+            current = 1 - current;
+            for(int i=0;i<3;++i){
+                low[i] = grownLow[i];
+                high[i] = grownHigh[i];
+            }
+        }
+    }
+    void birth(uint8_t *grid){
+        std::memset(grid, 0, bodyGridVolume);
+        forEachSlice([this, grid](int z){
+            for(int y=low[1];y<=high[1];++y){
+                size_t offset = index(low[0], y, z);
+                std::memcpy(grid + offset, grids[current].get() + offset, high[0] - low[0] + 1);
+            }
+        });
+    }
+    void release(){
+        pool.reset();
+        grids[0].reset();
+        grids[1].reset();
+    }
+
+private:
+    static size_t index(int x, int y, int z){
+        return x + 256*y + 256*256*size_t(z);
+    }
+    ///@returns What the voxel at x, y, z holds after stage
+    uint8_t grow(const uint8_t *from, int x, int y, int z, int stage) const{
+        uint8_t cell = from[index(x, y, z)];
+        if(cell){
+            return cell;
+        }
+        static const int offsets[6][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+        uint32_t roll = x*0x8DA6B343u ^ y*0xD8163841u ^ z*0xCB1AB31Fu ^ stage*0x9E3779B9u;
+        roll = (roll ^ roll >> 15) * 0x2C1B3C6Du;
+        roll ^= roll >> 12;
+        for(int d=0;d<6;++d){
+            uint8_t neighbour = from[index(x + offsets[d][0], y + offsets[d][1], z + offsets[d][2])];
+            //The neighbour in direction d grows towards the opposite direction
+            if(neighbour && ((roll >> (4*d)) & 0xFF) < spreadThresholds[neighbour - 1][d^1]){
+                return childTypes[neighbour - 1][d^1];
+            }
+        }
+        return 0;
+    }
+    template<class Task>
+    void forEachSlice(Task task){
+        int low = this->low[2];
+        pool->parallelFor(high[2] - low + 1, [&](int slice, int){
+            task(low + slice);
+        });
+    }
+
+    std::unique_ptr<WorkerPool> pool;
+    std::unique_ptr<uint8_t[]> grids[2];
+    int current = 0;
+    ///The bounding box of the body developed so far, inclusive
+    int low[3] = {128, 128, 128};
+    int high[3] = {128, 128, 128};
+    uint8_t spreadThresholds[stemCellsTypes][6] = {};
+    uint8_t childTypes[stemCellsTypes][6] = {};
+};
@@ -0,0 +1,101 @@
+#pragma once
+///@file development-pipeline.hpp
+///@brief Overlaps the development of genomes with the CPU work on the bodies already birthed
+
+#include <evo-devo-gpu.hpp>
+#include <body-storage.hpp>
+#include <worker-pool.hpp>
+#include <evolution-statistics.hpp>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*!
+ * @brief   Develops batches of genomes on the calling thread while a WorkerPool processes the grids already birthed
+ * birthBody is a synchronous readback, so developing and then storing, isolating and scoring one genome at a time leaves the GPU idle during the CPU work and vice versa.
+ * The pipeline keeps a ring of readback grids: the calling thread, which owns the backend and its context, develops into a free grid and submits it to the pool,
+ * whose threads hand it to a callback and then free it. With a depth of 1 development and processing simply alternate.
+ * @tparam  Backend A development backend, see development-backend.hpp
+ */
+template<class Backend>
+class DevelopmentPipeline{
+public:
+    /*!
+     * @param[in]   backend     An initialized backend, only ever used from the thread calling develop()
+     * @param[in]   pool        The threads birthed grids are processed on
+     * @param[in]   depth       How many birthed grids can wait for or be under processing at once, 0 picks one more than the threads in pool
+     */
+    DevelopmentPipeline(Backend *backend, WorkerPool *pool, int depth) : backend(backend), pool(pool){
+        depth = depth < 1 ? pool->size() + 1 : depth;
+        for(int i=0;i<depth;++i){
+            grids.emplace_back(new uint8_t[bodyGridVolume]);
+            freeGrids.push_back(i);
+        }
+    }
+    DevelopmentPipeline(const DevelopmentPipeline&) = delete;
+    DevelopmentPipeline& operator=(const DevelopmentPipeline&) = delete;
+
+    ///@returns How many genomes can be between development and the end of their processing at once
+    int depth() const{
+        return grids.size();
+    }
+
+    /*!
+     * @brief   Develops count genomes, returning once all of them have been processed
+     * @param[in]   count               How many genomes to develop
+     * @param[in]   developmentStages   How many turns each development will take
+     * @param[in]   genomeAt            Called on this thread with an index in [0, count) to get the genome to develop, or nullptr to stop developing before count
+     * @param[in]   finish              Called on the pool, in no particular order, with the index, the birthed grid and the index of the pool thread. The grid can be modified but not kept
+     * @param[in]   progress            Called on this thread with each index as its development starts, may be empty
+     * @param[in]   times               If not null, where this thread's time spent developing and birthing is added
+     */
+    template<class GenomeAt>
+    void develop(int count, int developmentStages, GenomeAt genomeAt, std::function<void(int, uint8_t*, int)> finish, std::function<void(int)> progress = nullptr, PhaseTimes *times = nullptr){
+        for(int k=0;k<count;++k){
+            int grid;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                gridFreed.wait(lock, [this]{return !freeGrids.empty();});
+                grid = freeGrids.back();
+                freeGrids.pop_back();
+            }
+            Genome_t *genome = genomeAt(k);
+            if(!genome){
+                std::lock_guard<std::mutex> lock(mutex);
+                freeGrids.push_back(grid);
+                break;
+            }
+            if(progress){
+                progress(k);
+            }
+            {
+                PhaseScope scope(times, PhaseTimes::DEVELOPMENT);
+                backend->load(genome);
+                backend->develop(developmentStages);
+            }
+            {
+                PhaseScope scope(times, PhaseTimes::READBACK);
+                backend->birth(grids[grid].get());
+            }
+            pool->submit([this, &finish, k, grid](int thread){
+                finish(k, grids[grid].get(), thread);
+                std::lock_guard<std::mutex> lock(mutex);
+                freeGrids.push_back(grid);
+                gridFreed.notify_all();
+            });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        gridFreed.wait(lock, [this]{return freeGrids.size()==grids.size();});
+    }
+
+private:
+    Backend *backend;
+    WorkerPool *pool;
+    std::vector<std::unique_ptr<uint8_t[]>> grids;
+    std::vector<int> freeGrids;
+    std::mutex mutex;
+    std::condition_variable gridFreed;
+};
@@ -0,0 +1,143 @@
+#pragma once
+///@file evolution-statistics.hpp
+///@brief What each generation of evolve() cost, for whoever wants to know
+/*! Timings are only taken when EvolutionSettings::statistics is set, otherwise every PhaseScope is a null check.
+ *  printGenerationStatistics is a ready-made sink that prints them to std::cout, and writeGenerationStatistics writes them to any stream.
+ */
+
+#include <ctime>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+
+///Wall clock and CPU time, in seconds
+struct PhaseTime{
+    double wall = 0;
+    double cpu = 0;
+    PhaseTime& operator+=(const PhaseTime &rhs){
+        wall += rhs.wall;
+        cpu += rhs.cpu;
+        return *this;
+    }
+};
+
+///The time one thread spent in each phase of a generation
+struct PhaseTimes{
+    ///The phases of a generation, in the order they happen
+    enum Phase{
+        SELECTION,
+        ///Computing genetic distances and picking crossover mates
+        MATE_SEARCH,
+        CROSSOVER,
+        MUTATION,
+        ///Loading genomes and running development, on the thread that owns the backend
+        DEVELOPMENT,
+        ///Birthing bodies into the readback grids
+        READBACK,
+        ///Turning birthed grids into BodyStorage
+        STORAGE,
+        ///Turning grids or BodyStorage into Body
+        ISOLATION,
+        ///Calls to the fitness function, or to extractFeatures and scoreFeatures
+        FITNESS,
+        PHASES_NUMBER
+    };
+    PhaseTime phases[PHASES_NUMBER];
+
+    void clear(){
+        for(auto &phase : phases){
+            phase = PhaseTime();
+        }
+    }
+    PhaseTimes& operator+=(const PhaseTimes &rhs){
+        for(int i=0;i<PHASES_NUMBER;++i){
+            phases[i] += rhs.phases[i];
+        }
+        return *this;
+    }
+};
+
+///The CPU time used so far by the calling thread
+inline double threadCpuTime(){
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+///The CPU time used so far by the whole process
+inline double processCpuTime(){
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec*1e-9;
+}
+
+///Adds the time from its construction to its destruction to a phase, unless times is null
+class PhaseScope{
+public:
+    PhaseScope(PhaseTimes *times, PhaseTimes::Phase phase) : times(times), phase(phase){
+        if(times){
+            wallStart = std::chrono::steady_clock::now();
+            cpuStart = threadCpuTime();
+        }
+    }
+    ~PhaseScope(){
+        if(times){
+            times->phases[phase].wall += std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+            times->phases[phase].cpu += threadCpuTime() - cpuStart;
+        }
+    }
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+    PhaseTimes *times;
+    PhaseTimes::Phase phase;
+    std::chrono::steady_clock::time_point wallStart;
+    double cpuStart;
+};
+
+///What it took to produce one generation
+struct GenerationStatistics{
+    ///The stage and repeat that produced this generation, both -1 for the initial population
+    int stage;
+    int repeat;
+    /*!
+     * Phases run on several threads at once add up the time of every thread, so their wall time can exceed total.wall:
+     * it is the time threads were busy with them, while total.wall is how long the generation took
+     */
+    PhaseTimes phases;
+    ///total.cpu is the CPU time of the whole process
+    PhaseTime total;
+    ///Children bred by crossover and mutation
+    int bred;
+    ///Children that had to be developed, the others came from the genome cache
+    int developed;
+    ///Individuals whose fitness was computed again because the weights changed
+    int rescored;
+    float bestFitness;
+    float meanFitness;
+};
+
+///Writes one line per generation to stream, leaving its formatting as it found it
+inline void writeGenerationStatistics(const GenerationStatistics &statistics, std::ostream &stream){
+    static const char *names[PhaseTimes::PHASES_NUMBER] = {"selection", "mates", "crossover", "mutation", "development", "readback", "storage", "isolation", "fitness"};
+    std::ios::fmtflags flags = stream.flags();
+    std::streamsize precision = stream.precision();
+    if(statistics.stage<0){
+        stream<<"Initial population: ";
+    } else{
+        stream<<"Stage "<<statistics.stage+1<<", repeat "<<statistics.repeat+1<<": ";
+    }
+    stream<<std::fixed<<std::setprecision(3)<<statistics.total.wall<<"s";
+    for(int i=0;i<PhaseTimes::PHASES_NUMBER;++i){
+        stream<<" "<<names[i]<<" "<<statistics.phases.phases[i].wall<<"s";
+    }
+    stream<<", "<<statistics.bred<<" bred, "<<statistics.developed<<" developed, "<<statistics.rescored<<" rescored, best fitness "<<statistics.bestFitness<<", mean fitness "<<statistics.meanFitness<<std::endl;
+    stream.flags(flags);
+    stream.precision(precision);
+}
+///Prints one line per generation to std::cout, for use as EvolutionSettings::statistics. It isn't an overload of writeGenerationStatistics so that it can be assigned directly
+inline void printGenerationStatistics(const GenerationStatistics &statistics){
+    writeGenerationStatistics(statistics, std::cout);
+}
@@ -0,0 +1,1102 @@
+#pragma once
+///@file evolver.hpp
+///@brief A long-lived object that runs selection plans, keeping its development context, threads and buffers from one run to the next
+
+#include <evo-devo-gpu.hpp>
+#include <selection-plan.hpp>
+#include <body-storage.hpp>
+#include <individual.hpp>
+#include <development-backend.hpp>
+#include <development-pipeline.hpp>
+#include <worker-pool.hpp>
+#include <fitness-scoring.hpp>
+#include <genetic-distance.hpp>
+#include <genome-cache.hpp>
+#include <genetic-operators.hpp>
+#include <static-plan.hpp>
+#include <random-streams.hpp>
+#include <checkpoint.hpp>
+#include <evolution-statistics.hpp>
+#include <generation-log.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+///What EvolutionSettings::migration is called with: the population as a repeat left it, and room for genomes to bring into it
+struct Migration{
+    int stage;
+    ///The last repeat before the migration
+    int repeat;
+    ///The genomes of the population, from the best individual to the worst. They are only valid during the call
+    std::vector<const Genome_t*> ranked;
+    ///The fitness of each genome in ranked
+    std::vector<float> fitness;
+    ///Genomes to replace the worst individuals with, at most one per individual. They are developed and scored with the weights of the repeat that just ended
+    std::vector<Genome_t> immigrants;
+};
+
+///Settings that change how evolve() runs, but not what it computes
+struct EvolutionSettings{
+    ///How many threads store, isolate and score bodies, 0 picks one per hardware thread
+    int threads = 0;
+    ///How many birthed bodies can wait for or be under CPU processing while the next genome develops. Each one takes a 16MB readback grid, 0 picks one more than threads.
+    ///Seeded STEADY_STATE runs depend on it, so set it for them to be reproducible on other machines
+    int developmentDepth = 0;
+    ///How many bytes of developed individuals to remember, so that genomes seen before don't develop again. 0 disables this, which is needed if development isn't deterministic
+    size_t genomeCacheBudget = size_t(256) << 20;
+    ///If not null, receives how much the genome cache was used when evolve() returns
+    GenomeCacheStatistics *genomeCacheStatistics = nullptr;
+    ///If not empty, a checkpoint is written here every checkpointInterval repeats, and when the plan is over. Checkpoints are written on a background thread
+    std::string checkpointPath;
+    int checkpointInterval = 1;
+    ///Whether checkpoints also save the bodies, so that resuming doesn't need to develop the population again
+    bool checkpointBodies = false;
+    ///If not empty, the run continues from this checkpoint instead of starting from new genomes.
+    ///The population size, and the plan up to the checkpoint, have to be the ones it was written with, though stages can be added after it: evolve() returns false without running if the checkpoint can't be read or doesn't fit them
+    std::string resumeFrom;
+    ///If set, called on the thread running the plan with what each generation cost, starting with the initial population. Phases are only timed when this is set.
+    ///printGenerationStatistics can be used here to print them
+    std::function<void(const GenerationStatistics&)> statistics;
+    ///Whether to print to std::cout which genome is developing and which repeat is running
+    bool printProgress = true;
+    ///If set, called on the thread running the plan every migrationInterval repeats, to exchange genomes with other populations. See island-model.hpp
+    std::function<void(Migration&)> migration;
+    int migrationInterval = 1;
+    ///If not empty, every generation's fitnesses and parents are appended here as they are produced, see generation-log.hpp. A resumed run continues the log from its checkpoint
+    std::string logPath;
+    ///Whether the log also saves every generation's genomes
+    bool logGenomes = false;
+    ///How many generations can wait to be logged before the run waits for the disk
+    int logCapacity = 4;
+};
+
+/*!
+ * @brief   Runs selection plans one after the other, without setting up and tearing down everything each time like evolve() does
+ * The development backend, the threads, the readback and scratch grids, the generation buffers, the genome cache and the individuals themselves
+ * are all kept from one run to the next, and only grow when a run needs more than the previous ones did.
+ * @tparam  W           The weights of the plans, see SelectionStage
+ * @tparam  T           The targets of the plans, see SelectionPlan
+ * @tparam  BodyStorage How each individual's grid is kept between generations, see body-storage.hpp
+ * @tparam  Backend     What develops the genomes, see development-backend.hpp
+ * @note    The constructor initializes the backend on the calling thread, which for OpenGLBackend makes its context current there and nowhere else.
+ *          Runs therefore have to be called from the thread that constructed the Evolver, or they return false without running, and so does its destructor, which releases the backend
+ */
+template<class W, class T, class BodyStorage = SparseBodyStorage, class Backend = OpenGLBackend>
+class Evolver{
+public:
+    /*!
+     * @param[in]   settings    threads and developmentDepth are only read here, the rest is read at the start of each run, so it can be changed in between through Evolver::settings
+     * @param[in]   backend     The backend to develop genomes with, initialized here and released by the destructor. If it can't be initialized, every run returns false
+     */
+    explicit Evolver(const EvolutionSettings &settings = EvolutionSettings(), Backend backend = Backend()) :
+            settings(settings),
+            owner(std::this_thread::get_id()),
+            backend(std::move(backend)),
+            pool(settings.threads),
+            pipeline(&this->backend, &pool, settings.developmentDepth),
+            scratches(pool.size() + 1),
+            threadTimes(pool.size() + 1),
+            distances(hammingGeneticDistance),
+            cache(settings.genomeCacheBudget){
+        backendReady = this->backend.initialize();
+        for(int i=0;i<stemCellsTypes*fieldsNumber*8 + 1;++i){
+            genesLoci[i] = i;
+        }
+        for(int i=1;i<7*fieldsNumber+1;++i){
+            genesLoci[stemCellsTypes*fieldsNumber*8 + i] = stemCellsTypes*fieldsNumber*8 +2*i;
+        }
+    }
+    ~Evolver(){
+        if(backendReady){
+            backend.release();
+        }
+    }
+    Evolver(const Evolver&) = delete;
+    Evolver& operator=(const Evolver&) = delete;
+
+    ///Executes an entire selection plan on a population, see the evolve() overload with the same parameters
+    bool run(Genome_t *genomes, int populationSize, int developmentStages, Body *bodies, float *fitness, const SelectionPlan<W, T> &plan, float fitnessFunction(Body *body, const T &targets, const W &weights), uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)=hammingGeneticDistance){
+        invalidateCache(developmentStages, nullptr);
+        return runPlan(genomes, populationSize, developmentStages, bodies, fitness, plan, FitnessFunctionScorer<W, T>{fitnessFunction}, geneticDistance, [this, &plan](int i, int j, int populationSize, uint64_t seed){
+            breedSubstages(plan.stages[i], i, j, populationSize, seed);
+        });
+    }
+    ///Executes an entire selection plan on a population, measuring each body only once, see the evolve() overload with the same parameters
+    bool run(Genome_t *genomes, int populationSize, int developmentStages, Body *bodies, float *fitness, const SelectionPlan<W, T> &plan, T extractFeatures(Body *body), float scoreFeatures(const T &features, const T &targets, const W &weights), uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)=hammingGeneticDistance){
+        invalidateCache(developmentStages, extractFeatures);
+        return runPlan(genomes, populationSize, developmentStages, bodies, fitness, plan, FeatureScorer<W, T>{extractFeatures, scoreFeatures}, geneticDistance, [this, &plan](int i, int j, int populationSize, uint64_t seed){
+            breedSubstages(plan.stages[i], i, j, populationSize, seed);
+        });
+    }
+    ///Executes a plan known at compile time on a population of its size, with each stage's substages unrolled. See static-plan.hpp, and the run() overload with the same parameters
+    template<int PopulationSize, class... Stages>
+    bool run(Genome_t *genomes, int developmentStages, Body *bodies, float *fitness, const StaticPlan<W, T, PopulationSize, Stages...> &plan, float fitnessFunction(Body *body, const T &targets, const W &weights), uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)=hammingGeneticDistance){
+        invalidateCache(developmentStages, nullptr);
+        //Everything but breeding reads the plan at the pace of repeats, so it reads the equivalent runtime plan
+        std::vector<SelectionStage<W>> stages;
+        return runPlan(genomes, PopulationSize, developmentStages, bodies, fitness, plan.toSelectionPlan(&stages), FitnessFunctionScorer<W, T>{fitnessFunction}, geneticDistance, [this, &plan](int i, int j, int populationSize, uint64_t seed){
+            plan.visitStage(i, [&](const auto &stage){
+                breedSubstages(stage, i, j, populationSize, seed);
+            });
+        });
+    }
+    ///Executes a plan known at compile time on a population of its size, measuring each body only once. See the other overloads
+    template<int PopulationSize, class... Stages>
+    bool run(Genome_t *genomes, int developmentStages, Body *bodies, float *fitness, const StaticPlan<W, T, PopulationSize, Stages...> &plan, T extractFeatures(Body *body), float scoreFeatures(const T &features, const T &targets, const W &weights), uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)=hammingGeneticDistance){
+        invalidateCache(developmentStages, extractFeatures);
+        std::vector<SelectionStage<W>> stages;
+        return runPlan(genomes, PopulationSize, developmentStages, bodies, fitness, plan.toSelectionPlan(&stages), FeatureScorer<W, T>{extractFeatures, scoreFeatures}, geneticDistance, [this, &plan](int i, int j, int populationSize, uint64_t seed){
+            plan.visitStage(i, [&](const auto &stage){
+                breedSubstages(stage, i, j, populationSize, seed);
+            });
+        });
+    }
+
+    ///Read at the start of each run, except for threads and developmentDepth
+    EvolutionSettings settings;
+
+private:
+    using IndividualType = Individual<BodyStorage, T>;
+
+    ///Forgets the individuals developed by previous runs if they don't hold what this run would have computed for them
+    void invalidateCache(int developmentStages, T (*extractFeatures)(Body *body)){
+        if(developmentStages!=cachedDevelopmentStages || extractFeatures!=cachedExtractFeatures){
+            cache.clear();
+            cachedDevelopmentStages = developmentStages;
+            cachedExtractFeatures = extractFeatures;
+        }
+    }
+    ///Added to the substage index in StreamId for the streams children are bred with, which leaves 127 substages per stage, as validateRun checks
+    static constexpr uint32_t breedingStreams = 0x80;
+    ///The substage index in StreamId of the streams STEADY_STATE children are bred with, as they don't belong to one substage
+    static constexpr uint32_t steadyStateStreams = 0xFF;
+
+    ///@returns Where the thread with this index adds the time it spends in each phase, or nullptr if phases aren't being timed. The thread running the plan is pool.size()
+    PhaseTimes* timesOf(int thread){
+        return settings.statistics ? &threadTimes[thread] : nullptr;
+    }
+    void startGeneration(){
+        if(!settings.statistics){
+            return;
+        }
+        for(auto &times : threadTimes){
+            times.clear();
+        }
+        generationStart = std::chrono::steady_clock::now();
+        generationCpuStart = processCpuTime();
+    }
+    ///Hands the population to the log, if there is one. Genomes are only referenced, and copied on the log's thread
+    void logGeneration(int stage, int repeat, int populationSize){
+        if(!log){
+            return;
+        }
+        std::unique_ptr<GenerationRecord> record = log->acquire();
+        record->stage = stage;
+        record->repeat = repeat;
+        record->fitness.assign(currentFitness.begin(), currentFitness.begin() + populationSize);
+        record->firstParents.assign(firstParents.begin(), firstParents.begin() + populationSize);
+        record->secondParents.assign(secondParents.begin(), secondParents.begin() + populationSize);
+        record->genomes.clear();
+        if(settings.logGenomes){
+            for(int k=0;k<populationSize;++k){
+                record->genomes.emplace_back(thisGen[k], &thisGen[k]->genome);
+            }
+        }
+        log->submit(std::move(record));
+    }
+    ///Logs the generation, and reports what it cost to settings.statistics
+    void finishGeneration(int stage, int repeat, int populationSize, int bred, int developed, int rescored, bool maximizeFitness){
+        //A resumed run's first generation is the last one its log already holds
+        if(stage >= 0 || !resuming){
+            logGeneration(stage, repeat, populationSize);
+        }
+        if(!settings.statistics){
+            return;
+        }
+        GenerationStatistics statistics;
+        statistics.stage = stage;
+        statistics.repeat = repeat;
+        for(auto &times : threadTimes){
+            statistics.phases += times;
+        }
+        statistics.total.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - generationStart).count();
+        statistics.total.cpu = processCpuTime() - generationCpuStart;
+        statistics.bred = bred;
+        statistics.developed = developed;
+        statistics.rescored = rescored;
+        auto fitness = currentFitness.begin();
+        statistics.bestFitness = maximizeFitness ? *std::max_element(fitness, fitness + populationSize) : *std::min_element(fitness, fitness + populationSize);
+        double sum = 0;
+        for(int k=0;k<populationSize;++k){
+            sum += fitness[k];
+        }
+        statistics.meanFitness = sum/populationSize;
+        settings.statistics(statistics);
+    }
+
+    ///Hands the current population to writer, which copies the genomes, and bodies if settings.checkpointBodies, on its own thread
+    void submitCheckpoint(CheckpointWriter<W> *writer, const SelectionPlan<W, T> &plan, int stage, int repeat, const W &previousWeights, uint64_t weightsVersion, uint64_t seed, int populationSize){
+        Checkpoint<W> checkpoint;
+        checkpoint.stage = stage;
+        checkpoint.repeat = repeat;
+        checkpoint.previousWeights = previousWeights;
+        checkpoint.weightsVersion = weightsVersion;
+        checkpoint.seed = seed;
+        checkpoint.planFingerprint = planFingerprint(plan, stage, repeat);
+        checkpoint.fitness.assign(currentFitness.begin(), currentFitness.begin() + populationSize);
+        //Individuals never change, so holding on to them is enough for the writer thread to copy genomes and bodies later
+        bool saveBodies = settings.checkpointBodies;
+        //A checkpoint on disk must never be ahead of the log, or a run resumed from it would continue the log past a gap, so the writer thread waits for the generations logged so far to be synced
+        GenerationLogWriter *logWriter = log.get();
+        uint64_t logged = log ? log->submitted() : 0;
+        writer->submit(std::move(checkpoint), [individuals = std::vector<IndividualHandle<BodyStorage, T>>(thisGen.begin(), thisGen.begin() + populationSize), saveBodies, logWriter, logged](Checkpoint<W> *checkpoint){
+            if(logWriter){
+                logWriter->waitWritten(logged);
+            }
+            BodyScratch scratch;
+            checkpoint->genomes.resize(individuals.size());
+            checkpoint->bodies.resize(saveBodies ? individuals.size() : 0);
+            for(size_t k=0;k<individuals.size();++k){
+                checkpoint->genomes[k] = individuals[k]->genome;
+                if(saveBodies){
+                    toSparseBody(individuals[k]->body, &checkpoint->bodies[k], &scratch);
+                }
+            }
+        });
+    }
+    ///Makes room for a population of populationSize in all buffers
+    void reserve(int populationSize){
+        thisGen.resize(populationSize);
+        nextGen.resize(populationSize);
+        children.resize(populationSize);
+        currentFitness.resize(populationSize);
+        nextFitness.resize(populationSize);
+        winners.resize(populationSize);
+        parents.resize(populationSize);
+        mates.resize(populationSize);
+        permutation.resize(populationSize);
+        firstParents.resize(populationSize);
+        secondParents.resize(populationSize);
+        invalidatedBodies.reserve(populationSize);
+        rescored.reserve(populationSize);
+        //Enough for both generations and all children, individuals beyond that only come back from the genome cache's evictions
+        individuals.setCapacity(3*size_t(populationSize));
+    }
+
+    ///Fills the next generation's slots [first, first + count) with individuals of this one, each picked by pick from the stream of its slot
+    template<class Pick>
+    void selectSubstage(int first, int count, uint64_t seed, StreamId picks, Pick pick){
+        {
+            PhaseScope scope(timesOf(pool.size()), PhaseTimes::SELECTION);
+            for(int l=0;l<count;++l){
+                RandomStream stream(seed, picks);
+                winners[first + l] = pick(&stream);
+                ++picks.slot;
+            }
+        }
+        for(int l=0;l<count;++l){
+            nextGen[first + l] = thisGen[winners[first + l]];
+            nextFitness[first + l] = currentFitness[winners[first + l]];
+            firstParents[first + l] = winners[first + l];
+            secondParents[first + l] = -1;
+        }
+    }
+    ///Breeds count children into children[first, first + count) by calling crossover on pairs of parents
+    template<class Crossover>
+    void crossoverSubstage(int populationSize, int first, int count, float desiredGeneticDistance, uint64_t seed, StreamId picks, StreamId breeding, Crossover crossover){
+        const int caller = pool.size();
+        //We select half of the parents according to their fitness with a roulette wheel,
+        //then they select their partners among the rest of the population according to genetic similarity, aiming for desiredGeneticDistance
+        //NOTE the distance is not absolute, but relative to the max distance in the population
+        {
+            PhaseScope scope(timesOf(caller), PhaseTimes::SELECTION);
+            for(int l=0;l<count;++l){
+                RandomStream stream(seed, picks);
+                parents[l] = selection.roulette(&stream);
+                ++picks.slot;
+            }
+        }
+        {
+            //Distances are computed on the pool, which this thread waits for
+            PhaseScope scope(timesOf(caller), PhaseTimes::MATE_SEARCH);
+            distances.computeRows(parents.data(), count, [this](int k) -> const Genome_t& {return thisGen[k]->genome;}, &pool);
+            selectMates(populationSize, parents.data(), count, desiredGeneticDistance, distances, mates.data());
+        }
+        pool.parallelFor(count, [&](int l, int thread){
+            PhaseScope scope(timesOf(thread), PhaseTimes::CROSSOVER);
+            auto &child = children[first + l];
+            child = individuals.make();
+            StreamId id = breeding;
+            id.slot += l;
+            RandomStream stream(seed, id);
+            crossover(thisGen[parents[l]]->genome, thisGen[mates[l]]->genome, &child->genome, genesLoci, sizeof(genesLoci)/sizeof(genesLoci[0]), &stream);
+        });
+        for(int l=0;l<count;++l){
+            invalidatedBodies.push_back(first + l);
+            firstParents[first + l] = parents[l];
+            secondParents[first + l] = mates[l];
+        }
+    }
+    ///Breeds count children into children[first, first + count) by mutating distinct individuals picked at random
+    void mutateSubstage(int populationSize, int first, int count, float mutationProbability, uint64_t seed, StreamId picks, StreamId breeding){
+        {
+            PhaseScope scope(timesOf(pool.size()), PhaseTimes::SELECTION);
+            //Inside-out Fisher-Yattes Shuffle to get a random permutation of [0, populationSize-1]
+            RandomStream shuffle(seed, picks);
+            for(int l=0;l<populationSize;++l){
+                int index = shuffle.below(l + 1);
+                if(index!=l){
+                    permutation[l] = permutation[index];
+                }
+                permutation[index] = l;
+            }
+        }
+        pool.parallelFor(count, [&](int l, int thread){
+            PhaseScope scope(timesOf(thread), PhaseTimes::MUTATION);
+            auto &child = children[first + l];
+            child = individuals.make();
+            child->genome = thisGen[permutation[l]]->genome;
+            StreamId id = breeding;
+            id.slot += l;
+            RandomStream stream(seed, id);
+            mutateGenomeFields(&child->genome, mutationProbability, &stream);
+        });
+        for(int l=0;l<count;++l){
+            invalidatedBodies.push_back(first + l);
+            firstParents[first + l] = permutation[l];
+            secondParents[first + l] = -1;
+        }
+    }
+    ///Fills the next generation with the substages of a runtime stage, dispatching on their types
+    void breedSubstages(const SelectionStage<W> &stage, int i, int j, int populationSize, uint64_t seed){
+        int individualsGenerated = 0;
+        for(size_t s=0;s<stage.substages.size();++s){
+            auto &substage = stage.substages[s];
+            //Picks draw from the streams of the slots they fill, children from the breeding streams of theirs
+            StreamId picks{uint32_t(i), uint32_t(j), uint32_t(s), uint32_t(individualsGenerated)};
+            StreamId breeding{uint32_t(i), uint32_t(j), uint32_t(s) | breedingStreams, uint32_t(individualsGenerated)};
+            switch(substage.type){
+                case SelectionSubstage::ROULETTE:
+                case SelectionSubstage::LINEAR:
+                case SelectionSubstage::EXPONENTIAL:
+                case SelectionSubstage::TOURNAMENT:
+                    selectSubstage(individualsGenerated, substage.individuals, seed, picks, [this, &substage](RandomStream *stream){return selection.select(substage, stream);});
+                    break;
+                case SelectionSubstage::TWO_POINTS_CO:
+                    crossoverSubstage(populationSize, individualsGenerated, substage.individuals, substage.param.desiredGeneticDistance, seed, picks, breeding, twoPointsGenomeCrossover);
+                    break;
+                case SelectionSubstage::UNIFORM_CO:
+                    crossoverSubstage(populationSize, individualsGenerated, substage.individuals, substage.param.desiredGeneticDistance, seed, picks, breeding, uniformGenomeCrossover);
+                    break;
+                case SelectionSubstage::MUTATE:
+                    mutateSubstage(populationSize, individualsGenerated, substage.individuals, substage.param.mutationProbability, seed, picks, breeding);
+                    break;
+            }
+            individualsGenerated+=substage.individuals;
+        }
+    }
+    ///Fills the next generation with the substages of a StaticStage, unrolled at compile time into the same sequence of calls the runtime stage would make
+    template<class... Substages>
+    void breedSubstages(const StaticStage<W, Substages...> &stage, int i, int j, int populationSize, uint64_t seed){
+        breedSubstages(stage, i, j, populationSize, seed, std::index_sequence_for<Substages...>());
+    }
+    template<class... Substages, size_t... S>
+    void breedSubstages(const StaticStage<W, Substages...> &stage, int i, int j, int populationSize, uint64_t seed, std::index_sequence<S...>){
+        (breedSubstage(std::get<S>(stage.substages), S, StaticStage<W, Substages...>::firstSlot(S), i, j, populationSize, seed), ...);
+    }
+    template<class Substage>
+    void breedSubstage(const Substage &substage, uint32_t s, int first, int i, int j, int populationSize, uint64_t seed){
+        StreamId picks{uint32_t(i), uint32_t(j), s, uint32_t(first)};
+        StreamId breeding{uint32_t(i), uint32_t(j), s | breedingStreams, uint32_t(first)};
+        if constexpr(Substage::type==SelectionSubstage::MUTATE){
+            mutateSubstage(populationSize, first, Substage::individuals, substage.mutationProbability, seed, picks, breeding);
+        } else if constexpr(bool(Substage::type & SelectionSubstage::TWO_POINTS_CO)){
+            crossoverSubstage(populationSize, first, Substage::individuals, substage.desiredGeneticDistance, seed, picks, breeding, [](const Genome_t &first, const Genome_t &second, Genome_t *child, const uint64_t *loci, size_t lociNumber, RandomStream *stream){
+                Substage::cross(first, second, child, loci, lociNumber, stream);
+            });
+        } else{
+            selectSubstage(first, Substage::individuals, seed, picks, [this, &substage](RandomStream *stream){return substage.pick(selection, stream);});
+        }
+    }
+
+    ///@returns The stage and repeat of the generation resumed was taken after, -1 and -1 for the initial population
+    std::pair<int, int> checkpointedGeneration(const SelectionPlan<W, T> &plan, const Checkpoint<W> &resumed) const{
+        int stage = resumed.stage;
+        int repeat = resumed.repeat - 1;
+        if(repeat < 0){
+            --stage;
+            repeat = stage < 0 ? -1 : plan.stages[stage].repeats - 1;
+        }
+        return {stage, repeat};
+    }
+
+    /*!
+     * @brief   Checks that plan can run on populationSize individuals with the current settings, before anything is changed
+     * The generation log, if any, is opened last, once nothing else can stop the run.
+     * @param[out]  resumed     The checkpoint to resume from, if settings.resumeFrom is set
+     * @returns Whether the run can go ahead. If not, the reason is printed to std::cerr
+     */
+    bool validateRun(int populationSize, const SelectionPlan<W, T> &plan, Checkpoint<W> *resumed){
+        if(std::this_thread::get_id()!=owner){
+            std::cerr<<"An Evolver has to run on the thread that constructed it, where its development backend was initialized"<<std::endl;
+            return false;
+        }
+        if(!backendReady){
+            std::cerr<<"The development backend couldn't be initialized"<<std::endl;
+            return false;
+        }
+        if(populationSize < 1){
+            std::cerr<<"Can't evolve a population of "<<populationSize<<" individuals"<<std::endl;
+            return false;
+        }
+        if(plan.number < 1 || !plan.stages){
+            std::cerr<<"Can't run a plan without stages"<<std::endl;
+            return false;
+        }
+        //Each repeat fills every slot of the next generation, and nothing more
+        for(int i=0;i<plan.number;++i){
+            //Substage indices share the StreamId byte with breedingStreams and steadyStateStreams, see StaticStage
+            if(plan.stages[i].substages.size() >= breedingStreams){
+                std::cerr<<"Stage "<<i+1<<" has "<<plan.stages[i].substages.size()<<" substages, more than the "<<breedingStreams - 1<<" it can have"<<std::endl;
+                return false;
+            }
+            int individuals = 0;
+            for(auto &substage : plan.stages[i].substages){
+                if(substage.individuals < 0){
+                    std::cerr<<"Stage "<<i+1<<" has a substage generating "<<substage.individuals<<" individuals"<<std::endl;
+                    return false;
+                }
+                //Outside of these ranges some ranks would get negative weights, or all of them none
+                if(substage.type==SelectionSubstage::LINEAR && !(substage.param.selectionPressure>0.f)){
+                    std::cerr<<"Stage "<<i+1<<" has a linear ranking substage with a selection pressure of "<<substage.param.selectionPressure<<", which isn't positive"<<std::endl;
+                    return false;
+                }
+                if(substage.type==SelectionSubstage::EXPONENTIAL && !(substage.param.k1>=0.f && substage.param.k1<=1.f)){
+                    std::cerr<<"Stage "<<i+1<<" has an exponential ranking substage with a k1 of "<<substage.param.k1<<", outside of [0, 1]"<<std::endl;
+                    return false;
+                }
+                individuals += substage.individuals;
+            }
+            if(individuals!=populationSize){
+                std::cerr<<"The substages of stage "<<i+1<<" generate "<<individuals<<" individuals instead of "<<populationSize<<std::endl;
+                return false;
+            }
+        }
+        if(plan.mode==STEADY_STATE){
+            for(int i=0;i<plan.number;++i){
+                int breeders = 0;
+                for(auto &substage : plan.stages[i].substages){
+                    breeders += substage.type&SelectionSubstage::TWO_POINTS_CO ? substage.individuals : 0;
+                }
+                if(breeders<=0){
+                    std::cerr<<"Stage "<<i+1<<" has no crossover or mutation individuals to breed in steady state mode"<<std::endl;
+                    return false;
+                }
+            }
+        }
+        if(!settings.resumeFrom.empty()){
+            if(!readCheckpoint(settings.resumeFrom, resumed, populationSize)){
+                std::cerr<<"Couldn't resume from "<<settings.resumeFrom<<", it isn't a readable checkpoint of "<<populationSize<<" individuals"<<std::endl;
+                return false;
+            }
+            //A finished plan's checkpoint points just past its last stage
+            bool finished = resumed->stage==plan.number && resumed->repeat==0;
+            if(!finished && (resumed->stage < 0 || resumed->stage >= plan.number || resumed->repeat < 0 || resumed->repeat >= plan.stages[resumed->stage].repeats)){
+                std::cerr<<"Can't resume from "<<settings.resumeFrom<<", stage "<<resumed->stage + 1<<" repeat "<<resumed->repeat + 1<<" isn't part of the plan"<<std::endl;
+                return false;
+            }
+            if(resumed->planFingerprint!=planFingerprint(plan, resumed->stage, resumed->repeat)){
+                std::cerr<<"Can't resume from "<<settings.resumeFrom<<", it was written by a different plan"<<std::endl;
+                return false;
+            }
+        }
+        if(!settings.logPath.empty()){
+            std::pair<int, int> checkpointed = checkpointedGeneration(plan, *resumed);
+            std::unique_ptr<GenerationLogWriter> opened(new GenerationLogWriter(settings.logPath, settings.logCapacity));
+            if(!opened->open(!resumed->genomes.empty(), checkpointed.first, checkpointed.second)){
+                return false;
+            }
+            log = std::move(opened);
+        }
+        return true;
+    }
+
+    /*!
+     * @param[in]   breedStage  Called with the stage, the repeat, the population size and the seed to fill the next generation, see breedSubstages()
+     * @returns Whether the plan was run, see validateRun()
+     */
+    template<class Scorer, class BreedStage>
+    bool runPlan(Genome_t *genomes, int populationSize, int developmentStages, Body *bodies, float *fitness, const SelectionPlan<W, T> &plan, const Scorer &scorer, uint64_t geneticDistance(const Genome_t& first, const Genome_t& second), BreedStage breedStage){
+        Checkpoint<W> resumed;
+        if(!validateRun(populationSize, plan, &resumed)){
+            return false;
+        }
+        reserve(populationSize);
+        distances.setGeneticDistance(geneticDistance);
+        cache.setMemoryBudget(settings.genomeCacheBudget);
+        //Fitnesses remembered from previous runs were computed against other targets
+        ++weightsVersion;
+        resuming = !resumed.genomes.empty();
+        //Checkpoints count weight versions from the start of their run
+        uint64_t firstWeightsVersion = weightsVersion - resumed.weightsVersion;
+        //The weights the current fitnesses were computed with, which carry over from one stage to the next
+        W previousWeights = resuming ? resumed.previousWeights : plan.stages[0].weights[0];
+        uint64_t seed = resuming ? resumed.seed : plan.seed;
+        if(!seed){
+            std::random_device rd;
+            seed = uint64_t(rd()) << 32 | rd();
+        }
+        for(int i=0;i<populationSize;++i){
+            children[i] = individuals.make();
+            if(resuming){
+                children[i]->genome = resumed.genomes[i];
+            } else if(plan.seed){
+                children[i]->genome = genomes[i];
+            } else{
+                generateGenome(&children[i]->genome);
+            }
+        }
+        const int caller = pool.size();
+        std::function<void(int)> progress;
+        startGeneration();
+        //Bodies restored from a checkpoint are released below, before the generation is reported
+        const bool developing = resumed.bodies.empty();
+        if(developing){
+            if(settings.printProgress){
+                progress = [populationSize](int k){
+                    std::cout<<"\rDeveloping genome "<<k+1<<" of "<<populationSize<<"..."<<std::flush;
+                };
+            }
+            pipeline.develop(populationSize, developmentStages, [&](int k){return &children[k]->genome;}, [&](int k, uint8_t *grid, int thread){
+                {
+                    PhaseScope scope(timesOf(thread), PhaseTimes::STORAGE);
+                    children[k]->body.store(grid);
+                }
+                currentFitness[k] = scorer.birth(children[k].get(), grid, &scratches[thread], plan.targets, previousWeights, timesOf(thread));
+            }, progress, timesOf(caller));
+        } else{
+            pool.parallelFor(populationSize, [&](int k, int thread){
+                uint8_t *grid = scratches[thread].zeroedGrid();
+                resumed.bodies[k].expand(grid);
+                {
+                    PhaseScope scope(timesOf(thread), PhaseTimes::STORAGE);
+                    children[k]->body.store(grid);
+                }
+                scorer.birth(children[k].get(), grid, &scratches[thread], plan.targets, previousWeights, timesOf(thread));
+                resumed.bodies[k].erase(grid);
+            });
+        }
+        if(resuming){
+            //Fitnesses are restored rather than recomputed, so that the run continues exactly as it would have
+            std::copy(resumed.fitness.begin(), resumed.fitness.end(), currentFitness.begin());
+            resumed.bodies = std::vector<SparseBodyStorage>();
+        }
+        for(int i=0;i<populationSize;++i){
+            thisGen[i] = std::move(children[i]);
+            cache.insert(thisGen[i], currentFitness[i], weightsVersion);
+        }
+        if(settings.printProgress){
+            std::cout<<std::endl;
+        }
+        std::fill(firstParents.begin(), firstParents.end(), -1);
+        std::fill(secondParents.begin(), secondParents.end(), -1);
+        //A log started anew on resume begins with the checkpointed generation, which a continued one already ends with
+        if(resuming && log && !log->continued()){
+            std::pair<int, int> checkpointed = checkpointedGeneration(plan, resumed);
+            logGeneration(checkpointed.first, checkpointed.second, populationSize);
+        }
+        finishGeneration(-1, -1, populationSize, 0, developing ? populationSize : 0, 0, plan.maximizeFitness);
+        std::unique_ptr<CheckpointWriter<W>> checkpointWriter;
+        if(!settings.checkpointPath.empty()){
+            checkpointWriter.reset(new CheckpointWriter<W>(settings.checkpointPath));
+        }
+        if(plan.mode==STEADY_STATE){
+            runSteadyState(populationSize, developmentStages, plan, scorer, seed, resumed, previousWeights, checkpointWriter.get(), firstWeightsVersion);
+        } else{
+            int repeatsSinceCheckpoint = 0;
+            int repeatsSinceMigration = 0;
+            for(int i=resumed.stage;i<plan.number;++i){
+                for(int j=i==resumed.stage ? resumed.repeat : 0;j<plan.stages[i].repeats;++j){
+                    if(settings.printProgress){
+                        std::cout<<"Stage "<<i+1<<" of "<<plan.number<<", repeat "<<j+1<<" of "<<plan.stages[i].repeats<<std::endl;
+                    }
+                    startGeneration();
+                    W weights = plan.stages[i].weights[0] + plan.stages[i].weights[1]*j;
+                    bool weightsChanged = !(weights==previousWeights);
+                    if(weightsChanged){
+                        ++weightsVersion;
+                    }
+                    distances.reset(populationSize);
+                    selection.reset(populationSize, currentFitness.data(), plan.maximizeFitness);
+                    breedStage(i, j, populationSize, seed);
+                    std::sort(invalidatedBodies.begin(), invalidatedBodies.end());
+                    int bred = invalidatedBodies.size();
+                    //Children whose genome developed before get that individual back, and only need scoring if the weights changed since
+                    rescored.clear();
+                    size_t developing = 0;
+                    for(int k : invalidatedBodies){
+                        auto *entry = cache.find(children[k]->genome);
+                        if(!entry){
+                            invalidatedBodies[developing++] = k;
+                            continue;
+                        }
+                        nextGen[k] = entry->individual;
+                        nextFitness[k] = entry->fitness;
+                        if(entry->weightsVersion!=weightsVersion){
+                            rescored.push_back(k);
+                        }
+                        children[k].reset();
+                    }
+                    invalidatedBodies.resize(developing);
+                    //Children are scored with this repeat's weights as soon as they are birthed
+                    if(settings.printProgress){
+                        progress = [this](int k){
+                            std::cout<<"\rDeveloping genome "<<k+1<<" of "<<invalidatedBodies.size()<<std::flush;
+                        };
+                    }
+                    pipeline.develop(invalidatedBodies.size(), developmentStages, [&](int k){return &children[invalidatedBodies[k]]->genome;}, [&](int k, uint8_t *grid, int thread){
+                        auto &child = children[invalidatedBodies[k]];
+                        {
+                            PhaseScope scope(timesOf(thread), PhaseTimes::STORAGE);
+                            child->body.store(grid);
+                        }
+                        nextFitness[invalidatedBodies[k]] = scorer.birth(child.get(), grid, &scratches[thread], plan.targets, weights, timesOf(thread));
+                    }, progress, timesOf(caller));
+                    for(int k : invalidatedBodies){
+                        nextGen[k] = std::move(children[k]);
+                        cache.insert(nextGen[k], nextFitness[k], weightsVersion);
+                    }
+                    if(settings.printProgress){
+                        std::cout<<std::endl;
+                    }
+                    //Only the handles are swapped, and the previous generation is released right away so that only the survivors keep its individuals alive
+                    thisGen.swap(nextGen);
+                    for(auto &individual : nextGen){
+                        individual.reset();
+                    }
+                    currentFitness.swap(nextFitness);
+                    if(weightsChanged){
+                        //Everything that wasn't just developed still has the fitness it got with the previous weights
+                        rescored.clear();
+                        auto child = invalidatedBodies.begin();
+                        for(int k=0;k<populationSize;++k){
+                            if(child!=invalidatedBodies.end() && *child==k){
+                                ++child;
+                                continue;
+                            }
+                            rescored.push_back(k);
+                        }
+                    }
+                    pool.parallelFor(rescored.size(), [&](int l, int thread){
+                        currentFitness[rescored[l]] = scorer.rescore(*thisGen[rescored[l]], &scratches[thread], plan.targets, weights, timesOf(thread));
+                    });
+                    for(int k : rescored){
+                        cache.updateFitness(thisGen[k]->genome, currentFitness[k], weightsVersion);
+                    }
+                    int developed = invalidatedBodies.size();
+                    invalidatedBodies.clear();
+                    if(settings.migration && ++repeatsSinceMigration>=settings.migrationInterval){
+                        repeatsSinceMigration = 0;
+                        developed += migrate(i, j, populationSize, developmentStages, plan, scorer, weights);
+                    }
+                    finishGeneration(i, j, populationSize, bred, developed, rescored.size(), plan.maximizeFitness);
+                    previousWeights = weights;
+                    bool lastRepeat = i==plan.number - 1 && j==plan.stages[i].repeats - 1;
+                    if(checkpointWriter && (++repeatsSinceCheckpoint>=settings.checkpointInterval || lastRepeat)){
+                        repeatsSinceCheckpoint = 0;
+                        bool stageOver = j==plan.stages[i].repeats - 1;
+                        submitCheckpoint(checkpointWriter.get(), plan, stageOver ? i + 1 : i, stageOver ? 0 : j + 1, previousWeights, weightsVersion - firstWeightsVersion, seed, populationSize);
+                    }
+                }
+            }
+        }
+        pool.parallelFor(populationSize, [&](int k, int thread){
+            genomes[k] = thisGen[k]->genome;
+            if(bodies){
+                isolateBody(bodies + k, thisGen[k]->body, scratches[thread].zeroedGrid());
+            }
+        });
+        std::copy(currentFitness.begin(), currentFitness.begin() + populationSize, fitness);
+        if(settings.genomeCacheStatistics){
+            *settings.genomeCacheStatistics = cache.getStatistics();
+        }
+        //Checkpoints wait for the log, so the last one is written before it closes
+        checkpointWriter.reset();
+        //Waits for the last generations to be logged, which releases the individuals they hold
+        log.reset();
+        //Only the genome cache keeps individuals alive between runs
+        for(auto &individual : thisGen){
+            individual.reset();
+        }
+        return true;
+    }
+
+    /*!
+     * @brief   Hands the population to settings.migration, and brings in the genomes it returns in place of the worst individuals
+     * Immigrants are scored with weights, and only developed if the genome cache doesn't have them already.
+     * @returns How many immigrants were developed
+     */
+    template<class Scorer>
+    int migrate(int stage, int repeat, int populationSize, int developmentStages, const SelectionPlan<W, T> &plan, const Scorer &scorer, const W &weights){
+        const int caller = pool.size();
+        std::iota(permutation.begin(), permutation.begin() + populationSize, 0);
+        std::stable_sort(permutation.begin(), permutation.begin() + populationSize, [&](int a, int b){
+            return plan.maximizeFitness ? currentFitness[a] > currentFitness[b] : currentFitness[a] < currentFitness[b];
+        });
+        exchange.stage = stage;
+        exchange.repeat = repeat;
+        exchange.ranked.resize(populationSize);
+        exchange.fitness.resize(populationSize);
+        for(int k=0;k<populationSize;++k){
+            exchange.ranked[k] = &thisGen[permutation[k]]->genome;
+            exchange.fitness[k] = currentFitness[permutation[k]];
+        }
+        exchange.immigrants.clear();
+        settings.migration(exchange);
+        int arrivals = std::min<int>(exchange.immigrants.size(), populationSize);
+        for(int l=0;l<arrivals;++l){
+            int k = permutation[populationSize - 1 - l];
+            firstParents[k] = -1;
+            secondParents[k] = -1;
+            auto *entry = cache.find(exchange.immigrants[l]);
+            if(!entry){
+                children[k] = individuals.make();
+                children[k]->genome = exchange.immigrants[l];
+                invalidatedBodies.push_back(k);
+                continue;
+            }
+            float fitness = entry->fitness;
+            if(entry->weightsVersion!=weightsVersion){
+                fitness = scorer.rescore(*entry->individual, &scratches[caller], plan.targets, weights, timesOf(caller));
+                cache.updateFitness(exchange.immigrants[l], fitness, weightsVersion);
+            }
+            thisGen[k] = entry->individual;
+            currentFitness[k] = fitness;
+        }
+        pipeline.develop(invalidatedBodies.size(), developmentStages, [&](int l){return &children[invalidatedBodies[l]]->genome;}, [&](int l, uint8_t *grid, int thread){
+            auto &child = children[invalidatedBodies[l]];
+            {
+                PhaseScope scope(timesOf(thread), PhaseTimes::STORAGE);
+                child->body.store(grid);
+            }
+            currentFitness[invalidatedBodies[l]] = scorer.birth(child.get(), grid, &scratches[thread], plan.targets, weights, timesOf(thread));
+        }, nullptr, timesOf(caller));
+        for(int k : invalidatedBodies){
+            thisGen[k] = std::move(children[k]);
+            cache.insert(thisGen[k], currentFitness[k], weightsVersion);
+        }
+        int developed = invalidatedBodies.size();
+        invalidatedBodies.clear();
+        return developed;
+    }
+
+    /*!
+     * @brief   Runs the plan in STEADY_STATE mode, from where resumed left off, on the population runPlan() developed
+     * Each repeat is evaluationsPerRepeat evaluations, and evaluation e of repeat j draws from the stream with repeat j and slot e whoever develops it,
+     * so children that come from the genome cache don't shift the streams of the following ones.
+     * Consecutive repeats with the same weights are fed to the pipeline at once, up to the next checkpoint.
+     * Children join the population in the order they were bred, each as soon as the one bred depth - 1 evaluations after it is, where depth is the pipeline's:
+     * evaluation e is always bred from the population evaluations before e - depth + 1 left, so that seeded runs don't depend on timing while depth children develop at once.
+     */
+    template<class Scorer>
+    void runSteadyState(int populationSize, int developmentStages, const SelectionPlan<W, T> &plan, const Scorer &scorer, uint64_t seed, const Checkpoint<W> &resumed, W &previousWeights, CheckpointWriter<W> *checkpointWriter, uint64_t firstWeightsVersion){
+        const int caller = pool.size();
+        const int interval = plan.evaluationsPerRepeat > 0 ? plan.evaluationsPerRepeat : populationSize;
+        //Guards thisGen, currentFitness, the genome cache, inFlight and scored, as children are scored on the pool while the next ones are bred on this thread
+        std::mutex populationMutex;
+        std::condition_variable joined;
+        struct Child{
+            std::shared_ptr<IndividualType> individual;
+            int evaluation;
+            int32_t parents[2];
+        };
+        struct Scored{
+            IndividualHandle<BodyStorage, T> individual;
+            float fitness;
+            int32_t parents[2];
+        };
+        //By pipeline index
+        std::unordered_map<int, Child> inFlight;
+        //By evaluation, the children waiting for the ones bred before them to join
+        std::unordered_map<int, Scored> scored;
+        const int depth = pipeline.depth();
+        const int lag = depth - 1;
+        bool populationChanged = true;
+        //The fitnesses selection ranks, as they were the last time it was rebuilt
+        std::vector<float> rankedFitness(populationSize);
+        std::vector<const SelectionSubstage*> breeders;
+        std::vector<const SelectionSubstage*> selectors;
+        //Substages are picked in proportion to their individuals
+        auto pickSubstage = [](const std::vector<const SelectionSubstage*> &substages, int total, RandomStream *stream){
+            int pick = stream->below(total);
+            for(auto *substage : substages){
+                if(pick < substage->individuals){
+                    return substage;
+                }
+                pick -= substage->individuals;
+            }
+            return substages.back();
+        };
+        //Replaces the worst individual, the first one if several are as bad
+        auto join = [&](const IndividualHandle<BodyStorage, T> &individual, float fitness, const int32_t parents[2]){
+            auto fitnesses = currentFitness.begin();
+            int worst = (plan.maximizeFitness ? std::min_element(fitnesses, fitnesses + populationSize) : std::max_element(fitnesses, fitnesses + populationSize)) - fitnesses;
+            thisGen[worst] = individual;
+            currentFitness[worst] = fitness;
+            firstParents[worst] = parents[0];
+            secondParents[worst] = parents[1];
+            populationChanged = true;
+        };
+        int repeatsSinceCheckpoint = 0;
+        int repeatsSinceMigration = 0;
+        for(int i=resumed.stage;i<plan.number;++i){
+            auto &stage = plan.stages[i];
+            breeders.clear();
+            selectors.clear();
+            int breedersTotal = 0;
+            int selectorsTotal = 0;
+            for(auto &substage : stage.substages){
+                if(substage.type&SelectionSubstage::TWO_POINTS_CO){
+                    breeders.push_back(&substage);
+                    breedersTotal += substage.individuals;
+                } else{
+                    selectors.push_back(&substage);
+                    selectorsTotal += substage.individuals;
+                }
+            }
+            for(int j=i==resumed.stage ? resumed.repeat : 0;j<stage.repeats;){
+                W weights = stage.weights[0] + stage.weights[1]*j;
+                int repeats = 1;
+                while(j + repeats < stage.repeats && !(checkpointWriter && repeatsSinceCheckpoint + repeats>=settings.checkpointInterval) && !(settings.migration && repeatsSinceMigration + repeats>=settings.migrationInterval)){
+                    W nextWeights = stage.weights[0] + stage.weights[1]*(j + repeats);
+                    if(!(nextWeights==weights)){
+                        break;
+                    }
+                    ++repeats;
+                }
+                if(settings.printProgress){
+                    std::cout<<"Stage "<<i+1<<" of "<<plan.number<<", repeat "<<j+1;
+                    if(repeats > 1){
+                        std::cout<<" to "<<j+repeats;
+                    }
+                    std::cout<<" of "<<stage.repeats<<std::endl;
+                }
+                startGeneration();
+                //Parents are traced back to the population as the previous group of repeats left it, which is the previous logged generation
+                for(int k=0;k<populationSize;++k){
+                    firstParents[k] = k;
+                    secondParents[k] = -1;
+                }
+                int rescored = 0;
+                if(!(weights==previousWeights)){
+                    //Nothing is in development between groups of repeats, so this is the only time the population waits
+                    ++weightsVersion;
+                    pool.parallelFor(populationSize, [&](int k, int thread){
+                        currentFitness[k] = scorer.rescore(*thisGen[k], &scratches[thread], plan.targets, weights, timesOf(thread));
+                    });
+                    for(int k=0;k<populationSize;++k){
+                        cache.updateFitness(thisGen[k]->genome, currentFitness[k], weightsVersion);
+                    }
+                    rescored = populationSize;
+                    populationChanged = true;
+                    previousWeights = weights;
+                }
+                const int evaluations = repeats*interval;
+                int evaluation = 0;
+                int joinedEvaluations = 0;
+                int developed = 0;
+                //Joins the scored children that are next in line, up to lag evaluations behind the last one bred, or all of them once breeding is over
+                auto joinScored = [&](bool all){
+                    for(auto next=scored.find(joinedEvaluations);next!=scored.end() && (all || joinedEvaluations < evaluation - lag);next=scored.find(joinedEvaluations)){
+                        cache.insert(next->second.individual, next->second.fitness, weightsVersion);
+                        join(next->second.individual, next->second.fitness, next->second.parents);
+                        scored.erase(next);
+                        ++joinedEvaluations;
+                    }
+                };
+                std::function<void(int)> progress;
+                if(settings.printProgress){
+                    progress = [&evaluation, evaluations](int){
+                        std::cout<<"\rEvaluating child "<<evaluation<<" of "<<evaluations<<std::flush;
+                    };
+                }
+                pipeline.develop(evaluations, developmentStages, [&](int k) -> Genome_t* {
+                    std::unique_lock<std::mutex> lock(populationMutex);
+                    //Children whose genome developed before take their fitness from the genome cache, and the next evaluation is bred in their place
+                    while(evaluation < evaluations){
+                        joinScored(false);
+                        joined.wait(lock, [&]{return joinedEvaluations >= evaluation - lag;});
+                        //Selection is rebuilt at most once every depth evaluations, and outside the lock so that the children being scored don't wait for it. Nothing joins meanwhile, as every child that can already has
+                        if(populationChanged && evaluation%depth==0){
+                            std::copy(currentFitness.begin(), currentFitness.begin() + populationSize, rankedFitness.begin());
+                            populationChanged = false;
+                            lock.unlock();
+                            selection.reset(populationSize, rankedFitness.data(), plan.maximizeFitness);
+                            {
+                                PhaseScope scope(timesOf(caller), PhaseTimes::SELECTION);
+                                for(auto *selector : selectors){
+                                    selection.prepare(*selector);
+                                }
+                                if(selectors.empty()){
+                                    selection.prepare(SelectionSubstage(SelectionSubstage::ROULETTE, 0, 0));
+                                }
+                            }
+                            lock.lock();
+                        }
+                        //Nothing joins until evaluation moves on, which only this thread does once the child is bred, so the population stays as it is without the lock.
+                        //Children finishing development meanwhile only take it to hand in their body
+                        lock.unlock();
+                        RandomStream stream(seed, StreamId{uint32_t(i), uint32_t(j + evaluation/interval), steadyStateStreams, uint32_t(evaluation%interval)});
+                        const SelectionSubstage *breeder;
+                        int parent;
+                        {
+                            PhaseScope scope(timesOf(caller), PhaseTimes::SELECTION);
+                            breeder = pickSubstage(breeders, breedersTotal, &stream);
+                            parent = selectorsTotal > 0 ? selection.select(*pickSubstage(selectors, selectorsTotal, &stream), &stream) : selection.roulette(&stream);
+                        }
+                        std::shared_ptr<IndividualType> child = individuals.make();
+                        int32_t lineage[2] = {firstParents[parent], -1};
+                        if(breeder->type==SelectionSubstage::MUTATE){
+                            PhaseScope scope(timesOf(caller), PhaseTimes::MUTATION);
+                            child->genome = thisGen[parent]->genome;
+                            mutateGenomeFields(&child->genome, breeder->param.mutationProbability, &stream);
+                        } else{
+                            int mate;
+                            {
+                                //The pool is busy with the children in development, so the parent's distances are computed on this thread
+                                PhaseScope scope(timesOf(caller), PhaseTimes::MATE_SEARCH);
+                                distances.reset(populationSize);
+                                distances.computeRow(parent, [this](int k) -> const Genome_t& {return thisGen[k]->genome;});
+                                selectMates(populationSize, &parent, 1, breeder->param.desiredGeneticDistance, distances, &mate);
+                            }
+                            lineage[1] = firstParents[mate];
+                            PhaseScope scope(timesOf(caller), PhaseTimes::CROSSOVER);
+                            if(breeder->type==SelectionSubstage::TWO_POINTS_CO){
+                                twoPointsGenomeCrossover(thisGen[parent]->genome, thisGen[mate]->genome, &child->genome, genesLoci, sizeof(genesLoci)/sizeof(genesLoci[0]), &stream);
+                            } else{
+                                uniformGenomeCrossover(thisGen[parent]->genome, thisGen[mate]->genome, &child->genome, genesLoci, sizeof(genesLoci)/sizeof(genesLoci[0]), &stream);
+                            }
+                        }
+                        auto *entry = cache.find(child->genome);
+                        float fitness = 0;
+                        IndividualHandle<BodyStorage, T> known;
+                        if(entry){
+                            known = entry->individual;
+                            fitness = entry->fitness;
+                            if(entry->weightsVersion!=weightsVersion){
+                                fitness = scorer.rescore(*known, &scratches[caller], plan.targets, weights, timesOf(caller));
+                                cache.updateFitness(child->genome, fitness, weightsVersion);
+                                ++rescored;
+                            }
+                        }
+                        lock.lock();
+                        ++evaluation;
+                        if(!entry){
+                            ++developed;
+                            Child &breeding = inFlight[k];
+                            breeding.individual = std::move(child);
+                            breeding.evaluation = evaluation - 1;
+                            breeding.parents[0] = lineage[0];
+                            breeding.parents[1] = lineage[1];
+                            return &breeding.individual->genome;
+                        }
+                        scored[evaluation - 1] = Scored{std::move(known), fitness, {lineage[0], lineage[1]}};
+                    }
+                    return nullptr;
+                }, [&](int k, uint8_t *grid, int thread){
+                    Child child;
+                    {
+                        std::lock_guard<std::mutex> lock(populationMutex);
+                        child = std::move(inFlight[k]);
+                        inFlight.erase(k);
+                    }
+                    {
+                        PhaseScope scope(timesOf(thread), PhaseTimes::STORAGE);
+                        child.individual->body.store(grid);
+                    }
+                    float fitness = scorer.birth(child.individual.get(), grid, &scratches[thread], plan.targets, weights, timesOf(thread));
+                    std::lock_guard<std::mutex> lock(populationMutex);
+                    scored[child.evaluation] = Scored{std::move(child.individual), fitness, {child.parents[0], child.parents[1]}};
+                    joinScored(false);
+                    joined.notify_all();
+                }, progress, timesOf(caller));
+                joinScored(true);
+                if(settings.printProgress){
+                    std::cout<<std::endl;
+                }
+                repeatsSinceMigration += repeats;
+                if(settings.migration && repeatsSinceMigration>=settings.migrationInterval){
+                    repeatsSinceMigration = 0;
+                    developed += migrate(i, j + repeats - 1, populationSize, developmentStages, plan, scorer, weights);
+                    populationChanged = true;
+                }
+                finishGeneration(i, j + repeats - 1, populationSize, evaluations, developed, rescored, plan.maximizeFitness);
+                j += repeats;
+                repeatsSinceCheckpoint += repeats;
+                bool lastRepeat = i==plan.number - 1 && j==stage.repeats;
+                if(checkpointWriter && (repeatsSinceCheckpoint>=settings.checkpointInterval || lastRepeat)){
+                    repeatsSinceCheckpoint = 0;
+                    bool stageOver = j==stage.repeats;
+                    submitCheckpoint(checkpointWriter, plan, stageOver ? i + 1 : i, stageOver ? 0 : j, previousWeights, weightsVersion - firstWeightsVersion, seed, populationSize);
+                }
+            }
+        }
+    }
+
+    ///The thread that constructed the Evolver and initialized backend, the only one runs are accepted from
+    std::thread::id owner;
+    Backend backend;
+    ///Whether backend could be initialized, without which nothing can run
+    bool backendReady = false;
+    WorkerPool pool;
+    DevelopmentPipeline<Backend> pipeline;
+    ///One per pool thread, and one for the thread running the plan
+    std::vector<BodyScratch> scratches;
+    ///One per pool thread, and one for the thread running the plan
+    std::vector<PhaseTimes> threadTimes;
+    std::chrono::steady_clock::time_point generationStart;
+    double generationCpuStart;
+    IndividualPool<IndividualType> individuals;
+    //Generations only hold handles to immutable individuals, children are built through the mutable pointers in children before being handed to nextGen
+    std::vector<IndividualHandle<BodyStorage, T>> thisGen;
+    std::vector<IndividualHandle<BodyStorage, T>> nextGen;
+    std::vector<std::shared_ptr<IndividualType>> children;
+    std::vector<float> currentFitness;
+    std::vector<float> nextFitness;
+    std::vector<int> winners;
+    std::vector<int> parents;
+    std::vector<int> mates;
+    std::vector<int> permutation;
+    ///Where each individual of the population comes from in the previous logged generation, see generation-log.hpp
+    std::vector<int32_t> firstParents;
+    std::vector<int32_t> secondParents;
+    std::vector<int> invalidatedBodies;
+    std::vector<int> rescored;
+    uint64_t genesLoci[stemCellsTypes*fieldsNumber*8 + 7*fieldsNumber + 1];
+    GeneticDistanceCache distances;
+    SelectionContext selection;
+    Migration exchange;
+    ///Only open during a run that logs its generations
+    std::unique_ptr<GenerationLogWriter> log;
+    ///Whether the plan being run continues from a checkpoint
+    bool resuming = false;
+    GenomeCache<BodyStorage, T> cache;
+    ///What the individuals in cache were developed and measured with
+    int cachedDevelopmentStages = -1;
+    T (*cachedExtractFeatures)(Body *body) = nullptr;
+    ///Incremented whenever the weights change, to tell whether the fitness remembered by cache is still valid
+    uint64_t weightsVersion = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+///@file fitness-scoring.hpp
+///@brief The two ways evolve() can turn a body into a fitness
+/*! A scorer is asked for a fitness once when an individual is birthed, and again for every survivor whenever a stage's weights change.
+ *  FeatureScorer keeps the measurements it takes in Individual::features.
+ *  Both add the time they spend isolating bodies and computing fitnesses to times, unless it is null.
+ */
+
+#include <evo-devo-gpu.hpp>
+#include <body-storage.hpp>
+#include <individual.hpp>
+#include <evolution-statistics.hpp>
+
+///Scores bodies with a single fitness function, which means isolating every survivor's body again whenever the weights change
+template<class W, class T>
+struct FitnessFunctionScorer{
+    float (*fitnessFunction)(Body *body, const T &targets, const W &weights);
+
+    ///@param[in]   grid    The grid the individual's body has just been birthed into and stored from
+    template<class I>
+    float birth(I *individual, uint8_t *grid, BodyScratch *scratch, const T &targets, const W &weights, PhaseTimes *times) const{
+        Body *body;
+        {
+            PhaseScope scope(times, PhaseTimes::ISOLATION);
+            body = scratch->isolateGrid(grid, individual->body.occupiedCells());
+        }
+        PhaseScope scope(times, PhaseTimes::FITNESS);
+        return fitnessFunction(body, targets, weights);
+    }
+    template<class I>
+    float rescore(const I &individual, BodyScratch *scratch, const T &targets, const W &weights, PhaseTimes *times) const{
+        Body *body;
+        {
+            PhaseScope scope(times, PhaseTimes::ISOLATION);
+            body = scratch->isolate(individual.body);
+        }
+        PhaseScope scope(times, PhaseTimes::FITNESS);
+        return fitnessFunction(body, targets, weights);
+    }
+};
+
+///Measures each body once and keeps the measurements with the individual, so that new weights only cost a call to scoreFeatures per individual
+template<class W, class T>
+struct FeatureScorer{
+    T (*extractFeatures)(Body *body);
+    float (*scoreFeatures)(const T &features, const T &targets, const W &weights);
+
+    ///@param[in]   grid    The grid the individual's body has just been birthed into and stored from
+    template<class I>
+    float birth(I *individual, uint8_t *grid, BodyScratch *scratch, const T &targets, const W &weights, PhaseTimes *times) const{
+        Body *body;
+        {
+            PhaseScope scope(times, PhaseTimes::ISOLATION);
+            body = scratch->isolateGrid(grid, individual->body.occupiedCells());
+        }
+        PhaseScope scope(times, PhaseTimes::FITNESS);
+        individual->features = extractFeatures(body);
+        return scoreFeatures(individual->features, targets, weights);
+    }
+    template<class I>
+    float rescore(const I &individual, BodyScratch*, const T &targets, const W &weights, PhaseTimes *times) const{
+        PhaseScope scope(times, PhaseTimes::FITNESS);
+        return scoreFeatures(individual.features, targets, weights);
+    }
+};
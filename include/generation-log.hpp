@@ -0,0 +1,401 @@
+#pragma once
+///@file generation-log.hpp
+///@brief Recording every generation of a run to disk as it goes, and reading the recording back without copying it
+/*! A generation log starts with a header, all values in the machine's byte order:
+ *  | Field                         | Type                          |
+ *  |-------------------------------|-------------------------------|
+ *  | magic, "EVOLOG"               | char[8]                       |
+ *  | generationLogVersion          | uint32_t                      |
+ *  | sizeof(Genome_t)              | uint32_t                      |
+ *  Padded to 64 bytes, and followed by one block per generation, in the order they were produced:
+ *  | Field                         | Type                          |
+ *  |-------------------------------|-------------------------------|
+ *  | block size, in bytes          | uint64_t                      |
+ *  | stage, -1 for the initial population  | int32_t               |
+ *  | repeat, -1 for the initial population | int32_t               |
+ *  | population size               | int32_t                       |
+ *  | flags, 1 if genomes are saved | uint32_t                      |
+ *  | fitness                       | float[population size]        |
+ *  | first parents                 | int32_t[population size]      |
+ *  | second parents                | int32_t[population size]      |
+ *  | genomes, if saved             | Genome_t[population size]     |
+ *  where the header and each column start on a 64 bytes boundary, and the block ends on one.
+ *  A generation's columns are thus contiguous arrays a reader can use in place once the file is mapped, see GenerationLogReader.
+ *  Parents are indices in the previous block's population, -1 if unknown: the second parent is the crossover mate, or -1 if the individual was selected or mutated.
+ *  Blocks are only ever appended, so a file cut short by a crash loses at most its last, incomplete block.
+ */
+
+#include <evo-devo-gpu.hpp>
+#include <checkpoint.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///The version of the generation log format written by GenerationLogWriter
+constexpr uint32_t generationLogVersion = 1;
+
+///What the log keeps of one generation, see generation-log.hpp for the meaning of each field
+struct GenerationRecord{
+    int stage;
+    int repeat;
+    std::vector<float> fitness;
+    std::vector<int32_t> firstParents;
+    std::vector<int32_t> secondParents;
+    ///Either empty, or one per individual. The pointers keep the individuals alive until the record is written, so that genomes aren't copied on the generation loop
+    std::vector<std::shared_ptr<const Genome_t>> genomes;
+};
+
+///Rounds a size in bytes up to a whole number of 64 bytes lines, which is what every part of a generation log is aligned on
+constexpr uint64_t generationLogLines(uint64_t bytes){
+    return (bytes + 63)/64*64;
+}
+
+///One generation of a log, pointing into the mapped file
+struct GenerationView{
+    int stage;
+    int repeat;
+    int populationSize;
+    const float *fitness;
+    const int32_t *firstParents;
+    const int32_t *secondParents;
+    ///nullptr if genomes weren't saved
+    const Genome_t *genomes;
+};
+
+/*!
+ * @brief   Maps a generation log into memory and gives access to each generation in place
+ * Generations written after open() aren't seen until open() is called again, which the file being written to concurrently doesn't prevent.
+ */
+class GenerationLogReader{
+public:
+    GenerationLogReader() = default;
+    ~GenerationLogReader(){
+        close();
+    }
+    GenerationLogReader(const GenerationLogReader&) = delete;
+    GenerationLogReader& operator=(const GenerationLogReader&) = delete;
+
+    /*!
+     * @brief   Maps path, and indexes its complete generations
+     * @returns Whether the file could be mapped, and was written with this generationLogVersion and Genome_t
+     */
+    bool open(const std::string &path){
+        close();
+        int file = ::open(path.c_str(), O_RDONLY);
+        if(file<0){
+            return false;
+        }
+        struct stat status;
+        if(fstat(file, &status) || status.st_size < 64){
+            ::close(file);
+            return false;
+        }
+        mappedSize = status.st_size;
+        void *memory = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, file, 0);
+        ::close(file);
+        if(memory==MAP_FAILED){
+            mappedSize = 0;
+            return false;
+        }
+        mapped = (const uint8_t*) memory;
+        uint32_t header[2];
+        std::memcpy(header, mapped + 8, sizeof(header));
+        if(std::memcmp(mapped, "EVOLOG\0", 8) || header[0]!=generationLogVersion || header[1]!=sizeof(Genome_t)){
+            close();
+            return false;
+        }
+        uint64_t offset = 64;
+        while(offset + 64 <= mappedSize){
+            const uint8_t *block = mapped + offset;
+            uint64_t blockSize;
+            int32_t fields[3];
+            uint32_t flags;
+            std::memcpy(&blockSize, block, sizeof(blockSize));
+            std::memcpy(fields, block + 8, sizeof(fields));
+            std::memcpy(&flags, block + 20, sizeof(flags));
+            if(fields[2] < 0 || blockSize!=blockBytes(fields[2], flags & 1) || offset + blockSize > mappedSize){
+                break;
+            }
+            uint64_t column = generationLogLines(uint64_t(fields[2])*sizeof(float));
+            GenerationView view;
+            view.stage = fields[0];
+            view.repeat = fields[1];
+            view.populationSize = fields[2];
+            view.fitness = (const float*) (block + 64);
+            view.firstParents = (const int32_t*) (block + 64 + column);
+            view.secondParents = (const int32_t*) (block + 64 + 2*column);
+            view.genomes = flags & 1 ? (const Genome_t*) (block + 64 + 3*column) : nullptr;
+            generations.push_back(view);
+            offset += blockSize;
+        }
+        completeSize = offset;
+        return true;
+    }
+    void close(){
+        if(mapped){
+            munmap((void*) mapped, mappedSize);
+        }
+        mapped = nullptr;
+        mappedSize = 0;
+        completeSize = 0;
+        generations.clear();
+    }
+
+    ///@returns How many complete generations the file held when it was opened
+    size_t size() const{
+        return generations.size();
+    }
+    ///@returns A generation, valid until the reader is closed
+    const GenerationView& operator[](size_t generation) const{
+        return generations[generation];
+    }
+    ///@returns How many bytes the header and the complete generations take, the rest of the file being an incomplete generation
+    uint64_t completeBytes() const{
+        return completeSize;
+    }
+
+    ///@returns The size of the block of a generation
+    static uint64_t blockBytes(int populationSize, bool genomes){
+        uint64_t column = generationLogLines(uint64_t(populationSize)*sizeof(float));
+        return 64 + 3*column + (genomes ? generationLogLines(uint64_t(populationSize)*sizeof(Genome_t)) : 0);
+    }
+
+private:
+    const uint8_t *mapped = nullptr;
+    uint64_t mappedSize = 0;
+    uint64_t completeSize = 0;
+    std::vector<GenerationView> generations;
+};
+
+/*!
+ * @brief   Appends generations to a log on a background thread, so that the generation loop only hands records over
+ * At most capacity records wait to be written: submit() waits for the disk beyond that, rather than letting memory grow or dropping generations.
+ * Written records are handed back by acquire() with their buffers, so a run doesn't allocate once the first few generations are written.
+ */
+class GenerationLogWriter{
+public:
+    ///Nothing is written until open() succeeds
+    GenerationLogWriter(const std::string &path, int capacity) : path(path), capacity(capacity < 1 ? 1 : capacity){}
+
+    /*!
+     * @brief   Opens the log and starts writing records to it
+     * @param[in]   append          Whether to continue an existing log rather than starting a new one. A log that doesn't exist, or wasn't written with this generationLogVersion and Genome_t, is started anew, see continued()
+     * @param[in]   stage, repeat   When appending, the last generation to keep: the ones logged after it, which a resumed run produces again, are dropped along with an incomplete last one
+     * @returns Whether the log could be opened. A log to continue that doesn't reach the generation to keep isn't, since the parents of the next generation would then point into the wrong one.
+     *          If not, the reason is printed to std::cerr and the log is left as it was
+     */
+    bool open(bool append, int stage = -1, int repeat = -1){
+        if(append){
+            GenerationLogReader reader;
+            if(reader.open(path)){
+                uint64_t complete = 64;
+                size_t kept = 0;
+                for(;kept<reader.size() && (reader[kept].stage < stage || (reader[kept].stage==stage && reader[kept].repeat <= repeat));++kept){
+                    complete += GenerationLogReader::blockBytes(reader[kept].populationSize, reader[kept].genomes!=nullptr);
+                }
+                if(!kept || reader[kept - 1].stage!=stage || reader[kept - 1].repeat!=repeat){
+                    std::cerr<<"Generation log "<<path<<" doesn't reach the generation to continue from, stage "<<stage<<" repeat "<<repeat<<std::endl;
+                    return false;
+                }
+                reader.close();
+                if(access(path.c_str(), W_OK)){
+                    std::cerr<<"Couldn't open generation log "<<path<<std::endl;
+                    return false;
+                }
+                //Starting anew would lose the generations the log is continued to keep
+                if(truncate(path.c_str(), complete)){
+                    std::cerr<<"Couldn't drop what generation log "<<path<<" holds after stage "<<stage<<" repeat "<<repeat<<std::endl;
+                    return false;
+                }
+            } else{
+                append = false;
+            }
+        }
+        file.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+        //The stream can't be synced, but a descriptor of the same file can
+        descriptor = file ? ::open(path.c_str(), O_WRONLY) : -1;
+        if(descriptor<0){
+            std::cerr<<"Couldn't open generation log "<<path<<std::endl;
+            file.close();
+            return false;
+        }
+        if(!append){
+            uint8_t header[64] = {};
+            uint32_t fields[2] = {generationLogVersion, sizeof(Genome_t)};
+            std::memcpy(header, "EVOLOG\0", 8);
+            std::memcpy(header + 8, fields, sizeof(fields));
+            file.write((const char*) header, sizeof(header));
+            file.flush();
+        }
+        continuing = append;
+        //A log started anew has to be synced to its directory before anything synced in it survives a crash
+        directorySynced = append;
+        writer = std::thread(&GenerationLogWriter::write, this);
+        return true;
+    }
+    ///Finishes writing every record submitted
+    ~GenerationLogWriter(){
+        if(!writer.joinable()){
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+        ::close(descriptor);
+    }
+    GenerationLogWriter(const GenerationLogWriter&) = delete;
+    GenerationLogWriter& operator=(const GenerationLogWriter&) = delete;
+
+    ///@returns A record to fill and submit, possibly one already written, whose vectors still have their capacity
+    std::unique_ptr<GenerationRecord> acquire(){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(spare.empty()){
+            return std::unique_ptr<GenerationRecord>(new GenerationRecord());
+        }
+        std::unique_ptr<GenerationRecord> record = std::move(spare.back());
+        spare.pop_back();
+        return record;
+    }
+    ///@returns Whether an existing log is being continued, as opposed to a new one started
+    bool continued() const{
+        return continuing;
+    }
+    ///@returns How many records were submitted so far, which waitWritten() takes to wait for the last of them
+    uint64_t submitted(){
+        std::lock_guard<std::mutex> lock(mutex);
+        return submittedRecords;
+    }
+    /*!
+     * @brief   Waits until the first records submitted are written and synced to disk, which other threads may do while the generation loop goes on
+     * Only records waited for are synced, so that a log that isn't waited for costs no more than the writes
+     */
+    void waitWritten(uint64_t records){
+        std::unique_lock<std::mutex> lock(mutex);
+        if(records > syncRequested){
+            syncRequested = records;
+            changed.notify_all();
+        }
+        changed.wait(lock, [this, records]{return syncedRecords >= records;});
+    }
+    ///Queues a record to be written, waiting first if capacity records already are
+    void submit(std::unique_ptr<GenerationRecord> record){
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this]{return int(pending.size()) < capacity;});
+            pending.push_back(std::move(record));
+            ++submittedRecords;
+        }
+        changed.notify_all();
+    }
+
+private:
+    void write(){
+        std::unique_lock<std::mutex> lock(mutex);
+        for(;;){
+            changed.wait(lock, [this]{return stopping || !pending.empty() || syncRequested > syncedRecords;});
+            if(syncRequested > syncedRecords && writtenRecords >= syncRequested){
+                sync(lock);
+                continue;
+            }
+            if(pending.empty()){
+                if(stopping){
+                    return;
+                }
+                continue;
+            }
+            std::unique_ptr<GenerationRecord> record = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+            changed.notify_all();
+            if(!writeRecord(*record) && !failed){
+                std::cerr<<"Couldn't write generation log "<<path<<std::endl;
+                failed = true;
+            }
+            //Releases the individuals the genomes belong to
+            record->genomes.clear();
+            lock.lock();
+            spare.push_back(std::move(record));
+            ++writtenRecords;
+            changed.notify_all();
+        }
+    }
+    ///Syncs the records written so far, with lock held on entry and on return
+    void sync(std::unique_lock<std::mutex> &lock){
+        uint64_t records = writtenRecords;
+        lock.unlock();
+        bool synced = fdatasync(descriptor)==0 && (directorySynced || syncDirectoryOf(path));
+        directorySynced = directorySynced || synced;
+        lock.lock();
+        if(!synced && !failed){
+            std::cerr<<"Couldn't sync generation log "<<path<<std::endl;
+            failed = true;
+        }
+        //Waiters are released even if the sync failed, as they would otherwise wait forever
+        syncedRecords = records;
+        changed.notify_all();
+    }
+    bool writeRecord(const GenerationRecord &record){
+        static const uint8_t padding[64] = {};
+        auto put = [this](const void *data, size_t size){file.write((const char*) data, size);};
+        auto pad = [&](uint64_t size){put(padding, generationLogLines(size) - size);};
+        int32_t populationSize = record.fitness.size();
+        bool genomes = !record.genomes.empty();
+        uint64_t blockSize = GenerationLogReader::blockBytes(populationSize, genomes);
+        int32_t fields[3] = {record.stage, record.repeat, populationSize};
+        uint32_t flags = genomes;
+        put(&blockSize, sizeof(blockSize));
+        put(fields, sizeof(fields));
+        put(&flags, sizeof(flags));
+        pad(sizeof(blockSize) + sizeof(fields) + sizeof(flags));
+        put(record.fitness.data(), populationSize*sizeof(float));
+        pad(populationSize*sizeof(float));
+        put(record.firstParents.data(), populationSize*sizeof(int32_t));
+        pad(populationSize*sizeof(int32_t));
+        put(record.secondParents.data(), populationSize*sizeof(int32_t));
+        pad(populationSize*sizeof(int32_t));
+        if(genomes){
+            for(auto &genome : record.genomes){
+                put(genome.get(), sizeof(Genome_t));
+            }
+            pad(populationSize*sizeof(Genome_t));
+        }
+        //Readers following the log only see whole generations
+        file.flush();
+        return bool(file);
+    }
+
+    std::string path;
+    int capacity;
+    std::ofstream file;
+    int descriptor = -1;
+    bool directorySynced = false;
+    std::deque<std::unique_ptr<GenerationRecord>> pending;
+    std::vector<std::unique_ptr<GenerationRecord>> spare;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool continuing = false;
+    bool stopping = false;
+    uint64_t submittedRecords = 0;
+    ///Records are written in the order they were submitted, so this many first ones are on disk
+    uint64_t writtenRecords = 0;
+    ///The first records waitWritten() waits for, and how many of the first records are synced
+    uint64_t syncRequested = 0;
+    uint64_t syncedRecords = 0;
+    bool failed = false;
+    std::thread writer;
+};
@@ -0,0 +1,197 @@
+#pragma once
+///@file genetic-distance.hpp
+///@brief Genetic distances, and the cache the crossover substages look them up in
+
+#include <evo-devo-gpu.hpp>
+#include <worker-pool.hpp>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*!
+ * @brief   The number of bits that differ between two genomes
+ * Compares 32 bytes at a time when built with AVX2, 8 bytes at a time otherwise.
+ */
+inline uint64_t hammingGeneticDistance(const Genome_t &first, const Genome_t &second){
+    const uint8_t *a = (const uint8_t*) &first;
+    const uint8_t *b = (const uint8_t*) &second;
+    uint64_t distance = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    //Population count of each nibble through a lookup table, summed per 64 bits lane by _mm256_sad_epu8
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibbles = _mm256_set1_epi8(0x0f);
+    __m256i lanes = _mm256_setzero_si256();
+    for(;i+32<=sizeof(Genome_t);i+=32){
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(x, lowNibbles)),
+                                         _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), lowNibbles)));
+        lanes = _mm256_add_epi64(lanes, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+    }
+    distance += _mm256_extract_epi64(lanes, 0) + _mm256_extract_epi64(lanes, 1) + _mm256_extract_epi64(lanes, 2) + _mm256_extract_epi64(lanes, 3);
+#endif
+    for(;i+sizeof(uint64_t)<=sizeof(Genome_t);i+=sizeof(uint64_t)){
+        uint64_t x, y;
+        std::memcpy(&x, a + i, sizeof(x));
+        std::memcpy(&y, b + i, sizeof(y));
+        distance += __builtin_popcountll(x ^ y);
+    }
+    for(;i<sizeof(Genome_t);++i){
+        distance += __builtin_popcount(a[i] ^ b[i]);
+    }
+    return distance;
+}
+
+/*!
+ * @brief   Remembers the genetic distances computed within a generation
+ * Distances are computed a row at a time, a row being the distances between an individual and the whole population,
+ * and are valid until reset() is called, which has to happen whenever the genomes of the population change.
+ * Only the rows asked for are stored, so a generation costs as many rows as it has distinct parents rather than a full matrix.
+ * Rows are kept from one generation to the next to be reused, and only allocated when a generation needs more of them than any before it.
+ */
+class GeneticDistanceCache{
+public:
+    ///@param[in]   geneticDistance A function that describes the similarity between two genomes, called concurrently by the threads of the WorkerPool passed to computeRows()
+    explicit GeneticDistanceCache(uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)) : geneticDistance(geneticDistance){}
+
+    ///Changes the distance function, which takes effect at the next reset()
+    void setGeneticDistance(uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)){
+        this->geneticDistance = geneticDistance;
+    }
+
+    ///Forgets all distances, and resizes the cache for a population of populationSize
+    void reset(int populationSize){
+        if(populationSize!=this->populationSize){
+            this->populationSize = populationSize;
+            rows.clear();
+            rowGeneration.assign(populationSize, 0);
+            rowIndex.resize(populationSize);
+            generation = 0;
+        }
+        rowsUsed = 0;
+        if(++generation==pending){
+            rowGeneration.assign(populationSize, 0);
+            generation = 1;
+        }
+    }
+    /*!
+     * @brief   Makes sure the rows of some individuals are available, computing the missing ones on pool
+     * @param[in]   individuals     Indices of the individuals, duplicates are fine
+     * @param[in]   count           The length of individuals
+     * @param[in]   genomeAt        genomeAt(i) returns a reference to the genome of individual i
+     */
+    template<class GenomeAt>
+    void computeRows(const int *individuals, int count, GenomeAt genomeAt, WorkerPool *pool){
+        std::vector<int> missing;
+        for(int i=0;i<count;++i){
+            uint32_t &rowState = rowGeneration[individuals[i]];
+            if(rowState!=generation && rowState!=pending){
+                //Duplicates are computed once, and the symmetric lookup below ignores rows that are being computed
+                rowState = pending;
+                assignRow(individuals[i]);
+                missing.push_back(individuals[i]);
+            }
+        }
+        pool->parallelFor(missing.size(), [&](int k, int){
+            fillRow(missing[k], genomeAt);
+        });
+        for(int individual : missing){
+            rowGeneration[individual] = generation;
+        }
+    }
+    ///Makes sure the row of one individual is available, computing it on this thread if it is missing. See computeRows()
+    template<class GenomeAt>
+    void computeRow(int individual, GenomeAt genomeAt){
+        if(rowGeneration[individual]==generation){
+            return;
+        }
+        assignRow(individual);
+        fillRow(individual, genomeAt);
+        rowGeneration[individual] = generation;
+    }
+    ///@returns The distances between individual and the whole population. computeRows() or computeRow() has to have been called for individual since the last reset()
+    const uint64_t* row(int individual) const{
+        return rows[rowIndex[individual]].get();
+    }
+    ///@returns How many rows are allocated, the most any generation since the population size last changed needed
+    size_t rowsAllocated() const{
+        return rows.size();
+    }
+
+private:
+    ///Hands the next unused row to individual, allocating it if every row is used
+    void assignRow(int individual){
+        if(rowsUsed==rows.size()){
+            rows.emplace_back(new uint64_t[populationSize]);
+        }
+        rowIndex[individual] = rowsUsed++;
+    }
+    template<class GenomeAt>
+    void fillRow(int individual, GenomeAt genomeAt){
+        uint64_t *row = rows[rowIndex[individual]].get();
+        for(int m=0;m<populationSize;++m){
+            row[m] = rowGeneration[m]==generation ? rows[rowIndex[m]][individual] : geneticDistance(genomeAt(individual), genomeAt(m));
+        }
+    }
+
+    uint64_t (*geneticDistance)(const Genome_t& first, const Genome_t& second);
+    int populationSize = 0;
+    std::vector<std::unique_ptr<uint64_t[]>> rows;
+    ///How many of rows hold distances of this generation
+    size_t rowsUsed = 0;
+    ///The value of generation when each individual's row was computed, or pending
+    std::vector<uint32_t> rowGeneration;
+    ///Which of rows is each individual's, if computed during this generation
+    std::vector<uint32_t> rowIndex;
+    uint32_t generation = 0;
+    static constexpr uint32_t pending = UINT32_MAX;
+};
+
+/*!
+ * @brief   Picks a mate for each parent among the individuals that aren't parents themselves, aiming for a genetic distance
+ * @param[in]   populationSize          The number of individuals
+ * @param[in]   parents                 The indices of the parents
+ * @param[in]   parentsNumber           The length of parents
+ * @param[in]   desiredGeneticDistance  The distance to aim for, relative to the largest distance between a parent and an individual that isn't a parent
+ * @param[in]   distances               Has to have the rows of all parents computed
+ * @param[out]  mates                   The index of the mate of each parent. If all individuals are parents, each parent mates with itself
+ */
+inline void selectMates(int populationSize, const int *parents, int parentsNumber, float desiredGeneticDistance, const GeneticDistanceCache &distances, int *mates){
+    std::vector<uint64_t> isParent((populationSize + 63)/64, 0);
+    for(int l=0;l<parentsNumber;++l){
+        isParent[parents[l]/64] |= uint64_t(1) << (parents[l]%64);
+    }
+    auto candidate = [&isParent](int m){return !((isParent[m/64] >> (m%64)) & 1);};
+    uint64_t maxDelta = 0;
+    for(int l=0;l<parentsNumber;++l){
+        const uint64_t *row = distances.row(parents[l]);
+        for(int m=0;m<populationSize;++m){
+            if(candidate(m) && row[m] > maxDelta){
+                maxDelta = row[m];
+            }
+        }
+    }
+    for(int l=0;l<parentsNumber;++l){
+        const uint64_t *row = distances.row(parents[l]);
+        float bestDelta = FLT_MAX;
+        mates[l] = parents[l];
+        for(int m=0;m<populationSize;++m){
+            if(candidate(m)){
+                float delta = desiredGeneticDistance - row[m]/float(maxDelta);
+                if(delta < bestDelta){
+                    bestDelta = delta;
+                    mates[l] = m;
+                    if(bestDelta==0){
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
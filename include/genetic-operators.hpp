@@ -0,0 +1,313 @@
+#pragma once
+///@file genetic-operators.hpp
+///@brief The selection, crossover and mutation functions evolve() runs, drawing their randomness from random-streams.hpp
+/*! They do what their genetic-algorithm-- and evo-devo-gpu counterparts do, but each pick and each child gets its own RandomStream,
+ *  so that the result only depends on the seed, and picks and children can be computed on any thread in any order.
+ */
+
+#include <evo-devo-gpu.hpp>
+#include <random-streams.hpp>
+#include <selection-plan.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+///Draws from a discrete distribution in constant time, with Vose's alias method
+class AliasTable{
+public:
+    ///@param[in]   weights How likely each index is, up to a factor. If they are all 0 every index is equally likely
+    void build(const double *weights, int size){
+        probability.resize(size);
+        alias.resize(size);
+        small.clear();
+        large.clear();
+        double total = 0;
+        for(int i=0;i<size;++i){
+            total += weights[i];
+        }
+        for(int i=0;i<size;++i){
+            probability[i] = total > 0 ? weights[i]*size/total : 1.;
+            alias[i] = i;
+            (probability[i] < 1. ? small : large).push_back(i);
+        }
+        while(!small.empty() && !large.empty()){
+            int lesser = small.back();
+            int greater = large.back();
+            small.pop_back();
+            alias[lesser] = greater;
+            probability[greater] -= 1. - probability[lesser];
+            if(probability[greater] < 1.){
+                large.pop_back();
+                small.push_back(greater);
+            }
+        }
+        //Whatever is left only differs from 1 by rounding errors
+        for(int i : small){
+            probability[i] = 1.;
+        }
+        for(int i : large){
+            probability[i] = 1.;
+        }
+    }
+    int sample(RandomStream *stream) const{
+        int i = stream->below(probability.size());
+        return stream->uniform() < probability[i] ? i : alias[i];
+    }
+
+private:
+    std::vector<double> probability;
+    std::vector<int> alias;
+    std::vector<int> small;
+    std::vector<int> large;
+};
+
+/*!
+ * @brief   What the selection substages of a generation share: the population ranked once, and a table to sample each distribution in constant time
+ * reset() is called once per generation with the new fitnesses, and whatever a substage needs is computed the first time it is needed and kept for the following substages.
+ * A generation thus costs one sort and one table per distinct distribution, plus constant time per pick, however many substages draw from it.
+ */
+class SelectionContext{
+public:
+    void reset(int populationSize, const float *fitness, bool maximize){
+        this->populationSize = populationSize;
+        this->fitness = fitness;
+        this->maximize = maximize;
+        ranked = false;
+        tablesUsed = 0;
+    }
+
+    ///Fitness proportionate selection. Fitnesses are shifted so that none is negative when maximizing, and flipped so that the worst gets nothing when minimizing
+    int roulette(RandomStream *stream){
+        return sample(rouletteTable(), stream);
+    }
+    /*!
+     * @brief   Linear ranking selection as genetic-algorithm-- defines it, rank r weighing selectionPressure/N - r*selectionPressure/(N*(N - 1)) in a population of N
+     * As picks are proportional to the weights, the best individual is twice as likely as the average one and the worst is never picked, whatever the pressure.
+     * selectionPressure has to be positive, which Evolver checks
+     */
+    int linearRanking(float selectionPressure, RandomStream *stream){
+        return sample(linearTable(selectionPressure), stream);
+    }
+    /*!
+     * @brief   Exponential ranking selection as genetic-algorithm-- defines it, rank r weighing k1*(1 - k1)^r
+     * Each individual is 1 - k1 times as likely as the one ranked just above it, so the larger k1 the stronger the pressure. k1 has to be in [0, 1], which Evolver checks
+     */
+    int exponentialRanking(float k1, RandomStream *stream){
+        return sample(exponentialTable(k1), stream);
+    }
+    ///Tournament selection: each pick is the best of tournamentSize individuals drawn with replacement
+    int tournament(int tournamentSize, RandomStream *stream){
+        int best = stream->below(populationSize);
+        for(int t=1;t<tournamentSize;++t){
+            int contender = stream->below(populationSize);
+            if(maximize ? fitness[contender] > fitness[best] : fitness[contender] < fitness[best]){
+                best = contender;
+            }
+        }
+        return best;
+    }
+    ///Picks one individual with a selection substage's function, which mustn't be a crossover or a mutation
+    int select(const SelectionSubstage &substage, RandomStream *stream){
+        switch(substage.type){
+            case SelectionSubstage::LINEAR:
+                return linearRanking(substage.param.selectionPressure, stream);
+            case SelectionSubstage::EXPONENTIAL:
+                return exponentialRanking(substage.param.k1, stream);
+            case SelectionSubstage::TOURNAMENT:
+                return tournament(substage.param.tournamentSize, stream);
+            default:
+                return roulette(stream);
+        }
+    }
+    ///Builds now whatever select() will need for substage, so that its picks only take constant time until the next reset()
+    void prepare(const SelectionSubstage &substage){
+        switch(substage.type){
+            case SelectionSubstage::LINEAR:
+                linearTable(substage.param.selectionPressure);
+                break;
+            case SelectionSubstage::EXPONENTIAL:
+                exponentialTable(substage.param.k1);
+                break;
+            case SelectionSubstage::TOURNAMENT:
+                break;
+            default:
+                rouletteTable();
+        }
+    }
+
+private:
+    struct Table{
+        SelectionSubstage::Type type;
+        float param;
+        ///Whether the table samples ranks rather than individuals
+        bool ranks;
+        AliasTable alias;
+    };
+
+    ///Ranks the population from the best to the worst individual, ties broken by index
+    void rank(){
+        if(ranked){
+            return;
+        }
+        order.resize(populationSize);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b){
+            return maximize ? fitness[a] > fitness[b] : fitness[a] < fitness[b];
+        });
+        ranked = true;
+    }
+    const Table& rouletteTable(){
+        return findTable(SelectionSubstage::ROULETTE, 0.f, [this](double *weights){
+            float lowest  = *std::min_element(fitness, fitness + populationSize);
+            float highest = *std::max_element(fitness, fitness + populationSize);
+            for(int k=0;k<populationSize;++k){
+                weights[k] = maximize ? fitness[k] - std::min(lowest, 0.f) : highest - fitness[k];
+            }
+        });
+    }
+    const Table& linearTable(float selectionPressure){
+        return findTable(SelectionSubstage::LINEAR, selectionPressure, [this, selectionPressure](double *weights){
+            for(int r=0;r<populationSize;++r){
+                weights[r] = populationSize > 1 ? double(selectionPressure)/populationSize - r*double(selectionPressure)/(double(populationSize)*(populationSize - 1)) : 1.;
+            }
+        });
+    }
+    const Table& exponentialTable(float k1){
+        return findTable(SelectionSubstage::EXPONENTIAL, k1, [this, k1](double *weights){
+            double weight = k1;
+            for(int r=0;r<populationSize;++r){
+                weights[r] = weight;
+                weight *= 1. - k1;
+            }
+        });
+    }
+    ///@param[in]   fillWeights Called to fill the weights of the individuals for roulette, or of the ranks otherwise, if the table has yet to be built
+    template<class FillWeights>
+    const Table& findTable(SelectionSubstage::Type type, float param, FillWeights fillWeights){
+        for(int i=0;i<tablesUsed;++i){
+            if(tables[i].type==type && tables[i].param==param){
+                return tables[i];
+            }
+        }
+        //Tables are kept from one generation to the next, so that they don't allocate again
+        if(tablesUsed==int(tables.size())){
+            tables.emplace_back();
+        }
+        Table &table = tables[tablesUsed++];
+        table.type = type;
+        table.param = param;
+        table.ranks = type!=SelectionSubstage::ROULETTE;
+        if(table.ranks){
+            rank();
+        }
+        weights.resize(populationSize);
+        fillWeights(weights.data());
+        table.alias.build(weights.data(), populationSize);
+        return table;
+    }
+    int sample(const Table &table, RandomStream *stream) const{
+        int pick = table.alias.sample(stream);
+        return table.ranks ? order[pick] : pick;
+    }
+
+    int populationSize = 0;
+    const float *fitness = nullptr;
+    bool maximize = true;
+    bool ranked = false;
+    std::vector<int> order;
+    std::vector<double> weights;
+    std::vector<Table> tables;
+    int tablesUsed = 0;
+};
+
+/*!
+ * @brief   Copies first into child, except for the bytes between two loci drawn at random, which are copied from second
+ * @param[in]   loci        The offsets genes start at, in increasing order. Crossover never splits a gene
+ */
+inline void twoPointsGenomeCrossover(const Genome_t &first, const Genome_t &second, Genome_t *child, const uint64_t *loci, size_t lociNumber, RandomStream *stream){
+    const uint8_t *a = (const uint8_t*) &first;
+    const uint8_t *b = (const uint8_t*) &second;
+    uint8_t *c = (uint8_t*) child;
+    size_t start = stream->below(lociNumber);
+    size_t end   = stream->below(lociNumber - 1);
+    end += end >= start;
+    if(start > end){
+        std::swap(start, end);
+    }
+    std::copy(a, a + loci[start], c);
+    std::copy(b + loci[start], b + loci[end], c + loci[start]);
+    std::copy(a + loci[end], a + sizeof(Genome_t), c + loci[end]);
+}
+
+///Copies each gene into child from either first or second, with equal probability. See twoPointsGenomeCrossover for loci
+inline void uniformGenomeCrossover(const Genome_t &first, const Genome_t &second, Genome_t *child, const uint64_t *loci, size_t lociNumber, RandomStream *stream){
+    const uint8_t *a = (const uint8_t*) &first;
+    const uint8_t *b = (const uint8_t*) &second;
+    uint8_t *c = (uint8_t*) child;
+    uint32_t bits = 0;
+    for(size_t l=0;l<lociNumber;++l){
+        if(l%32==0){
+            bits = stream->next();
+        }
+        size_t end = l + 1 < lociNumber ? loci[l + 1] : sizeof(Genome_t);
+        const uint8_t *parent = (bits >> (l%32)) & 1 ? b : a;
+        std::copy(parent + loci[l], parent + end, c + loci[l]);
+    }
+    std::copy(a, a + loci[0], c);
+}
+
+///Calls mutate(i) for each i in [0, count) with probability mutationProbability, jumping ahead geometrically distributed distances rather than drawing once per index
+template<class Mutate>
+void forEachMutated(size_t count, float mutationProbability, RandomStream *stream, Mutate mutate){
+    if(mutationProbability <= 0){
+        return;
+    }
+    double logKeep = std::log1p(-std::min(double(mutationProbability), 1. - 1e-12));
+    double position = std::floor(std::log1p(-stream->uniform())/logKeep);
+    while(position < count){
+        mutate(size_t(position));
+        position += 1 + std::floor(std::log1p(-stream->uniform())/logKeep);
+    }
+}
+
+///@returns A value in [0, range) other than current, or any value in [0, range) if current isn't in it
+inline uint32_t otherValue(uint32_t current, uint32_t range, RandomStream *stream){
+    if(current >= range){
+        return stream->below(range);
+    }
+    uint32_t value = stream->below(range - 1);
+    return value + (value >= current);
+}
+
+/*!
+ * @brief   Mutates each gene of genome with probability mutationProbability, the way evo-devo-gpu's mutateGenome does, keeping the genome legal
+ * Each mutated gene changes as little as it can: thresholds, permeabilities and amplitudes get one bit flipped, as does each 2 byte initial field value,
+ * while field types, next types and directions get another legal value, in [0, fieldsNumber), [0, stemCellsTypes) and the directions table respectively.
+ */
+inline void mutateGenomeFields(Genome_t *genome, float mutationProbability, RandomStream *stream){
+    auto flipBits = [mutationProbability, stream](uint8_t *bytes, size_t size, size_t geneSize){
+        forEachMutated(size/geneSize, mutationProbability, stream, [bytes, geneSize, stream](size_t gene){
+            uint32_t bit = stream->below(8*geneSize);
+            bytes[gene*geneSize + bit/8] ^= 1 << bit%8;
+        });
+    };
+    flipBits(genome->pulseThresholds, sizeof(genome->pulseThresholds), 1);
+    flipBits(genome->permeabilities, sizeof(genome->permeabilities), 1);
+    flipBits(genome->amplitudes, sizeof(genome->amplitudes), 1);
+    flipBits(genome->changeThresholds, sizeof(genome->changeThresholds), 1);
+    flipBits(genome->spawnThresholds, sizeof(genome->spawnThresholds), 1);
+    forEachMutated(sizeof(genome->fieldTypes), mutationProbability, stream, [genome, stream](size_t i){
+        genome->fieldTypes[i] = otherValue(genome->fieldTypes[i], fieldsNumber, stream);
+    });
+    forEachMutated(sizeof(genome->nextTypes), mutationProbability, stream, [genome, stream](size_t i){
+        genome->nextTypes[i] = otherValue(genome->nextTypes[i], stemCellsTypes, stream);
+    });
+    const size_t directionsNumber = sizeof(::directions)/sizeof(::directions[0]);
+    forEachMutated(sizeof(genome->directions)/sizeof(genome->directions[0]), mutationProbability, stream, [genome, stream, directionsNumber](size_t i){
+        size_t current = std::find(::directions, ::directions + directionsNumber, genome->directions[i]) - ::directions;
+        genome->directions[i] = ::directions[otherValue(current, directionsNumber, stream)];
+    });
+    flipBits((uint8_t*) genome->initialFieldsValues, sizeof(genome->initialFieldsValues), 2);
+}
@@ -0,0 +1,145 @@
+#pragma once
+///@file genome-cache.hpp
+///@brief Remembers developed individuals by genome, so that a genome seen before doesn't have to develop again
+
+#include <evo-devo-gpu.hpp>
+#include <individual.hpp>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+
+///A fast non-cryptographic hash of the bytes of a genome
+inline uint64_t hashGenome(const Genome_t &genome){
+    const uint8_t *bytes = (const uint8_t*) &genome;
+    uint64_t hash = sizeof(Genome_t) * 0x9e3779b97f4a7c15ull;
+    size_t i = 0;
+    for(;i+sizeof(uint64_t)<=sizeof(Genome_t);i+=sizeof(uint64_t)){
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    for(;i<sizeof(Genome_t);++i){
+        hash = (hash ^ bytes[i]) * 0xc4ceb9fe1a85ec53ull;
+    }
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    return hash ^ (hash >> 32);
+}
+
+///How much a GenomeCache has been useful
+struct GenomeCacheStatistics{
+    ///Lookups that found an individual, each one is a development saved
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    ///Individuals forgotten to stay within the memory budget
+    uint64_t evictions = 0;
+    uint64_t entries = 0;
+    ///Bytes taken by the cached individuals, some of which may also be part of the population
+    size_t memoryUsed = 0;
+};
+
+/*!
+ * @brief   A least recently used cache of developed individuals, keyed by genome
+ * Besides the individual, each entry keeps the last fitness computed for it together with a version number for the weights it was computed with,
+ * so a hit can skip scoring too as long as the weights haven't changed.
+ * @note    This assumes development is deterministic, i.e. that the same genome always develops into the same body
+ */
+template<class BodyStorage, class Features>
+class GenomeCache{
+public:
+    struct Entry{
+        IndividualHandle<BodyStorage, Features> individual;
+        float fitness;
+        uint64_t weightsVersion;
+        uint64_t hash;
+        size_t memory;
+    };
+
+    ///@param[in]   memoryBudget    How many bytes of individuals to keep at most, 0 disables the cache
+    explicit GenomeCache(size_t memoryBudget) : memoryBudget(memoryBudget){}
+
+    ///@returns The entry of an individual with this genome, or nullptr. The entry is valid until the next call to insert()
+    Entry* find(const Genome_t &genome){
+        if(!memoryBudget){
+            return nullptr;
+        }
+        auto found = index.find(hashGenome(genome));
+        if(found==index.end() || std::memcmp(&found->second->individual->genome, &genome, sizeof(Genome_t))){
+            ++statistics.misses;
+            return nullptr;
+        }
+        ++statistics.hits;
+        entries.splice(entries.begin(), entries, found->second);
+        return &*found->second;
+    }
+    ///Adds an individual, forgetting the least recently used ones if the memory budget is exceeded
+    void insert(const IndividualHandle<BodyStorage, Features> &individual, float fitness, uint64_t weightsVersion){
+        if(!memoryBudget){
+            return;
+        }
+        uint64_t hash = hashGenome(individual->genome);
+        auto found = index.find(hash);
+        if(found!=index.end()){
+            //Either the same genome or a collision, in both cases the newest one wins
+            erase(found->second);
+        }
+        size_t memory = sizeof(Entry) + sizeof(Individual<BodyStorage, Features>) + individual->body.memoryFootprint();
+        entries.push_front(Entry{individual, fitness, weightsVersion, hash, memory});
+        index[hash] = entries.begin();
+        statistics.memoryUsed += memory;
+        ++statistics.entries;
+        while(statistics.memoryUsed > memoryBudget && entries.size() > 1){
+            erase(std::prev(entries.end()));
+            ++statistics.evictions;
+        }
+    }
+    ///Updates the fitness of the individual with this genome, if there is one, without counting as a lookup
+    void updateFitness(const Genome_t &genome, float fitness, uint64_t weightsVersion){
+        if(!memoryBudget){
+            return;
+        }
+        auto found = index.find(hashGenome(genome));
+        if(found!=index.end() && !std::memcmp(&found->second->individual->genome, &genome, sizeof(Genome_t))){
+            found->second->fitness = fitness;
+            found->second->weightsVersion = weightsVersion;
+        }
+    }
+    ///Forgets every individual, e.g. when the same genomes would now develop differently
+    void clear(){
+        entries.clear();
+        index.clear();
+        statistics.memoryUsed = 0;
+        statistics.entries = 0;
+    }
+    ///Changes how many bytes of individuals to keep at most, forgetting the least recently used ones if needed. 0 disables the cache and forgets everything
+    void setMemoryBudget(size_t memoryBudget){
+        this->memoryBudget = memoryBudget;
+        if(!memoryBudget){
+            clear();
+        }
+        while(statistics.memoryUsed > memoryBudget && entries.size() > 1){
+            erase(std::prev(entries.end()));
+            ++statistics.evictions;
+        }
+    }
+    const GenomeCacheStatistics& getStatistics() const{
+        return statistics;
+    }
+
+private:
+    void erase(typename std::list<Entry>::iterator entry){
+        statistics.memoryUsed -= entry->memory;
+        --statistics.entries;
+        index.erase(entry->hash);
+        entries.erase(entry);
+    }
+
+    size_t memoryBudget;
+    ///Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, typename std::list<Entry>::iterator> index;
+    GenomeCacheStatistics statistics;
+};
@@ -0,0 +1,82 @@
+#pragma once
+///@file individual.hpp
+///@brief Reference-counted records of the individuals of a population
+
+#include <evo-devo-gpu.hpp>
+#include <body-storage.hpp>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+///The Features of individuals whose scorer doesn't keep anything about them
+struct NoFeatures{};
+
+///A genome together with the body it developed into, and whatever the scorer measured on that body
+template<class BodyStorage, class Features = NoFeatures>
+struct Individual{
+    Genome_t genome;
+    BodyStorage body;
+    Features features;
+};
+
+///How a generation holds its individuals: once an Individual is handed out like this it is never modified again, so an individual surviving into the next generation only costs a reference count increment
+template<class BodyStorage, class Features = NoFeatures>
+using IndividualHandle = std::shared_ptr<const Individual<BodyStorage, Features>>;
+
+/*!
+ * @brief   Recycles individuals, so that a long-lived Evolver doesn't allocate and free one for every child it breeds
+ * Individuals made by the pool come back to it when their last handle is destroyed, on whatever thread that happens, and keep the memory their body storage had.
+ * The pool itself can be destroyed before the individuals it made.
+ */
+template<class I>
+class IndividualPool{
+public:
+    ///@param[in]   capacity    How many unused individuals to keep at most
+    explicit IndividualPool(size_t capacity = 0) : recycled(std::make_shared<Recycled>()){
+        recycled->capacity = capacity;
+    }
+    void setCapacity(size_t capacity){
+        std::lock_guard<std::mutex> lock(recycled->mutex);
+        recycled->capacity = capacity;
+        while(recycled->individuals.size() > capacity){
+            delete recycled->individuals.back();
+            recycled->individuals.pop_back();
+        }
+    }
+    ///@returns An individual whose contents are whatever its previous user left in it
+    std::shared_ptr<I> make(){
+        I *individual = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(recycled->mutex);
+            if(!recycled->individuals.empty()){
+                individual = recycled->individuals.back();
+                recycled->individuals.pop_back();
+            }
+        }
+        if(!individual){
+            individual = new I();
+        }
+        std::shared_ptr<Recycled> owner = recycled;
+        return std::shared_ptr<I>(individual, [owner](I *individual){
+            std::lock_guard<std::mutex> lock(owner->mutex);
+            if(owner->individuals.size() < owner->capacity){
+                owner->individuals.push_back(individual);
+            } else{
+                delete individual;
+            }
+        });
+    }
+
+private:
+    struct Recycled{
+        std::mutex mutex;
+        std::vector<I*> individuals;
+        size_t capacity;
+        ~Recycled(){
+            for(I *individual : individuals){
+                delete individual;
+            }
+        }
+    };
+    std::shared_ptr<Recycled> recycled;
+};
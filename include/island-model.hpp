@@ -0,0 +1,379 @@
+#pragma once
+///@file island-model.hpp
+///@brief Runs several populations at once, each in its own process, exchanging their best genomes every few repeats
+/*! A single evolve() call is bound to one process and one development context. evolveIslands() forks one process per island instead,
+ *  each with its own Evolver, plan, backend and threads, so that a search can spread over several GPUs or NUMA nodes of one machine.
+ *  Every migrationInterval repeats, each island publishes its best genomes in a ring of slots in shared memory, and takes in those of the islands the topology connects it to.
+ *  Islands wait for the migrants of their sources, so a run only depends on the plans, their seeds and the initial genomes, however long each island takes.
+ */
+
+#include <evolver.hpp>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+///Which islands receive the migrants of which
+enum IslandTopology{
+    ///Each island receives from the previous one, the first from the last
+    RING,
+    ///Each island receives from every other
+    FULLY_CONNECTED,
+    ///The first island receives from every other, and every other from the first
+    STAR
+};
+
+///How evolveIslands() splits and connects the populations
+struct IslandSettings{
+    ///How many populations, and processes, to run
+    int islands = 2;
+    IslandTopology topology = RING;
+    ///How many repeats each island runs between two migrations
+    int migrationInterval = 5;
+    ///How many of its best genomes an island sends at each migration. An island receiving from several others gets that many from each
+    int migrants = 1;
+    ///How many migrations an island can get ahead of the islands it sends to before it waits for them
+    int slots = 4;
+    ///Whether to bind each island to its share of the CPUs the process can run on, so that its threads and memory stay on one NUMA node
+    bool pinIslands = true;
+};
+
+///@returns The islands that island receives migrants from
+inline std::vector<int> islandSources(IslandTopology topology, int island, int islands){
+    std::vector<int> sources;
+    if(islands < 2){
+        return sources;
+    }
+    switch(topology){
+        case RING:
+            sources.push_back((island + islands - 1)%islands);
+            break;
+        case FULLY_CONNECTED:
+            for(int i=0;i<islands;++i){
+                if(i!=island){
+                    sources.push_back(i);
+                }
+            }
+            break;
+        case STAR:
+            if(island==0){
+                for(int i=1;i<islands;++i){
+                    sources.push_back(i);
+                }
+            } else{
+                sources.push_back(0);
+            }
+            break;
+    }
+    return sources;
+}
+
+/*!
+ * @brief   The memory islands share: their progress, their slots of migrants, and the final population of each
+ * It is mapped before forking, so every island sees it at the same address. Progress counters are lock-free atomics, which work across processes.
+ * Check mapped() before using it.
+ */
+class IslandExchange{
+public:
+    IslandExchange(int islands, int populationSize, const IslandSettings &settings) : populationSize(populationSize), migrants(std::min(settings.migrants, populationSize)), slots(std::max(settings.slots, 1)){
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "Islands synchronize through atomics in shared memory");
+        //Each region starts on a cache line, so that islands don't share lines they write to
+        auto cacheLines = [](size_t bytes){return (bytes + 63)/64*64;};
+        size_t progressOffset = cacheLines(sizeof(Header));
+        size_t migrantsOffset = progressOffset + size_t(islands)*sizeof(Progress);
+        size_t genomesOffset = migrantsOffset + cacheLines(size_t(islands)*slots*migrants*sizeof(Genome_t));
+        size_t fitnessOffset = genomesOffset + cacheLines(size_t(islands)*populationSize*sizeof(Genome_t));
+        size = fitnessOffset + size_t(islands)*populationSize*sizeof(float);
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if(memory==MAP_FAILED){
+            std::cerr<<"Couldn't map "<<size<<" bytes of shared memory for "<<islands<<" islands"<<std::endl;
+            memory = nullptr;
+            return;
+        }
+        uint8_t *bytes = (uint8_t*) memory;
+        header = new(bytes) Header();
+        progress = (Progress*) (bytes + progressOffset);
+        for(int i=0;i<islands;++i){
+            new(progress + i) Progress();
+        }
+        migrantGenomes = (Genome_t*) (bytes + migrantsOffset);
+        finalGenomes = (Genome_t*) (bytes + genomesOffset);
+        finalFitness = (float*) (bytes + fitnessOffset);
+        for(int i=0;i<islands;++i){
+            sources.push_back(islandSources(settings.topology, i, islands));
+            receivers.emplace_back();
+        }
+        for(int i=0;i<islands;++i){
+            for(int source : sources[i]){
+                receivers[source].push_back(i);
+            }
+        }
+    }
+    ~IslandExchange(){
+        if(memory){
+            munmap(memory, size);
+        }
+    }
+    IslandExchange(const IslandExchange&) = delete;
+    IslandExchange& operator=(const IslandExchange&) = delete;
+
+    ///@returns Whether the shared memory could be mapped
+    bool mapped() const{
+        return memory!=nullptr;
+    }
+    ///Publishes the best genomes of island for its next migration, and appends the migrants of its sources to immigrants once they are published
+    void migrate(int island, Migration *migration){
+        Progress &mine = progress[island];
+        uint64_t epoch = mine.published.load(std::memory_order_relaxed);
+        //The slot about to be written held the migration slots ago, which every receiver has to be done with
+        for(int receiver : receivers[island]){
+            waitFor([&]{
+                return progress[receiver].received.load(std::memory_order_acquire) + slots > epoch || progress[receiver].finished.load(std::memory_order_acquire);
+            });
+        }
+        Genome_t *slot = migrantGenomes + (uint64_t(island)*slots + epoch%slots)*migrants;
+        for(int l=0;l<migrants;++l){
+            slot[l] = *migration->ranked[l];
+        }
+        mine.published.store(epoch + 1, std::memory_order_release);
+        for(int source : sources[island]){
+            bool published = false;
+            waitFor([&]{
+                //An island is only finished after its last migration, so reading finished first tells whether it will still publish this one
+                bool finished = progress[source].finished.load(std::memory_order_acquire);
+                published = progress[source].published.load(std::memory_order_acquire) > epoch;
+                return published || finished;
+            });
+            if(published){
+                const Genome_t *received = migrantGenomes + (uint64_t(source)*slots + epoch%slots)*migrants;
+                migration->immigrants.insert(migration->immigrants.end(), received, received + migrants);
+            }
+        }
+        mine.received.store(epoch + 1, std::memory_order_release);
+    }
+    ///Tells the other islands that island won't migrate anymore
+    void finish(int island){
+        progress[island].finished.store(true, std::memory_order_release);
+    }
+    ///Makes every island waiting for another one exit, for when one of them failed
+    void abort(){
+        header->aborted.store(true, std::memory_order_release);
+    }
+    ///Where island leaves its final population
+    Genome_t* genomesOf(int island){
+        return finalGenomes + uint64_t(island)*populationSize;
+    }
+    float* fitnessOf(int island){
+        return finalFitness + uint64_t(island)*populationSize;
+    }
+
+private:
+    struct Header{
+        std::atomic<bool> aborted{false};
+    };
+    struct alignas(64) Progress{
+        ///How many migrations the island published, and received
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> received{0};
+        std::atomic<bool> finished{false};
+    };
+
+    ///Migrations are rare enough that polling costs nothing measurable
+    template<class Predicate>
+    void waitFor(Predicate predicate){
+        while(!predicate()){
+            if(header->aborted.load(std::memory_order_acquire)){
+                _exit(EXIT_FAILURE);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    int populationSize;
+    int migrants;
+    int slots;
+    size_t size;
+    void *memory;
+    Header *header;
+    Progress *progress;
+    Genome_t *migrantGenomes;
+    Genome_t *finalGenomes;
+    float *finalFitness;
+    std::vector<std::vector<int>> sources;
+    std::vector<std::vector<int>> receivers;
+};
+
+///Binds the calling process to its share of the CPUs it can run on, and @returns how many CPUs that is
+inline int pinIsland(int island, int islands){
+    cpu_set_t available;
+    if(sched_getaffinity(0, sizeof(available), &available)){
+        return 0;
+    }
+    std::vector<int> cpus;
+    for(int cpu=0;cpu<CPU_SETSIZE;++cpu){
+        if(CPU_ISSET(cpu, &available)){
+            cpus.push_back(cpu);
+        }
+    }
+    if(int(cpus.size()) < islands){
+        return 1;
+    }
+    //Consecutive CPUs are usually on the same node, so each island gets a contiguous range
+    cpu_set_t share;
+    CPU_ZERO(&share);
+    int first = cpus.size()*island/islands;
+    int last = cpus.size()*(island + 1)/islands;
+    for(int i=first;i<last;++i){
+        CPU_SET(cpus[i], &share);
+    }
+    sched_setaffinity(0, sizeof(share), &share);
+    return last - first;
+}
+
+///@returns The generation log island writes when the islands' settings log to logPath
+inline std::string islandLogPath(const std::string &logPath, int island){
+    return logPath + ".island" + std::to_string(island);
+}
+
+/*!
+ * @brief   Forks one process per island, runs its plan on it with runIsland, and waits for all of them
+ * @param[in]   runIsland   Called in the island's process with its Evolver, genomes, fitness and plan, and runs the plan with whichever Evolver::run overload applies, returning what it returns
+ * @returns Whether every island ran its plan, see evolveIslands()
+ */
+template<class W, class T, class BodyStorage, class Backend, class RunIsland>
+bool runIslands(Genome_t *genomes, int populationSize, float *fitness, const SelectionPlan<W, T> *plans, const IslandSettings &islands, EvolutionSettings settings, const std::function<Backend(int island)> &makeBackend, RunIsland runIsland){
+    if(islands.islands < 1 || populationSize < 1){
+        std::cerr<<"Can't run "<<islands.islands<<" islands of "<<populationSize<<" individuals"<<std::endl;
+        return false;
+    }
+    //Every island would otherwise write and rename the same checkpoint
+    if(!settings.checkpointPath.empty() || !settings.resumeFrom.empty()){
+        std::cerr<<"Islands can't be checkpointed or resumed, as their migrants aren't saved"<<std::endl;
+        return false;
+    }
+    IslandExchange exchange(islands.islands, populationSize, islands);
+    if(!exchange.mapped()){
+        return false;
+    }
+    //Anything buffered would otherwise be printed once per island
+    std::cout<<std::flush;
+    std::vector<pid_t> processes(islands.islands);
+    for(int i=0;i<islands.islands;++i){
+        processes[i] = fork();
+        if(processes[i] < 0){
+            std::cerr<<"Couldn't fork island "<<i<<std::endl;
+            exchange.abort();
+            break;
+        }
+        if(processes[i]==0){
+            if(islands.pinIslands){
+                int cpus = pinIsland(i, islands.islands);
+                if(!settings.threads){
+                    settings.threads = cpus;
+                }
+            }
+            if(!settings.logPath.empty()){
+                settings.logPath = islandLogPath(settings.logPath, i);
+            }
+            settings.migrationInterval = islands.migrationInterval;
+            settings.migration = [&exchange, i](Migration &migration){
+                exchange.migrate(i, &migration);
+            };
+            bool ran;
+            {
+                //The backend is only made and initialized here, so that islands share no device state
+                Evolver<W, T, BodyStorage, Backend> evolver(settings, makeBackend ? makeBackend(i) : Backend());
+                Genome_t *islandGenomes = exchange.genomesOf(i);
+                std::copy(genomes + uint64_t(i)*populationSize, genomes + uint64_t(i + 1)*populationSize, islandGenomes);
+                ran = runIsland(evolver, islandGenomes, exchange.fitnessOf(i), plans[i]);
+            }
+            //The parent notices, and stops the islands waiting for this one
+            if(!ran){
+                _exit(EXIT_FAILURE);
+            }
+            exchange.finish(i);
+            std::cout<<std::flush;
+            //Skips the destructors and exit handlers the parent will run
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    //Islands are polled rather than waited for in order, so that one failing is noticed while the others wait for its migrants
+    bool failed = false;
+    int running = 0;
+    for(pid_t process : processes){
+        running += process > 0;
+        failed = failed || process < 0;
+    }
+    while(running > 0){
+        for(int i=0;i<islands.islands;++i){
+            int status;
+            if(processes[i] <= 0 || waitpid(processes[i], &status, WNOHANG)==0){
+                continue;
+            }
+            processes[i] = 0;
+            --running;
+            if(!WIFEXITED(status) || WEXITSTATUS(status)!=EXIT_SUCCESS){
+                std::cerr<<"Island "<<i<<" failed"<<std::endl;
+                exchange.abort();
+                failed = true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if(failed){
+        return false;
+    }
+    for(int i=0;i<islands.islands;++i){
+        std::copy(exchange.genomesOf(i), exchange.genomesOf(i) + populationSize, genomes + uint64_t(i)*populationSize);
+        std::copy(exchange.fitnessOf(i), exchange.fitnessOf(i) + populationSize, fitness + uint64_t(i)*populationSize);
+    }
+    return true;
+}
+
+/*!
+ * @brief   Executes a selection plan on each of several populations, each in its own process, exchanging their best genomes periodically
+ * Each island works like evolve() on its own population, except that every islands.migrationInterval repeats its best islands.migrants genomes are sent to the islands
+ * that receive from it, and the genomes it receives replace its worst individuals. Islands only share memory, so each one can use its own GPU and CPUs.
+ * @param[out]  genomes             The initial genomes of every island, one population after the other, and their final values when the function returns.
+ *                                  As with evolve(), the initial values are only used if the island's plan has a seed
+ * @param[in]   populationSize      The size of each island's population
+ * @param[out]  fitness             The fitness of the final populations, one after the other
+ * @param[in]   plans               One plan per island. Give each island its own seed, or islands starting from the same genomes will evolve the same way
+ * @param[in]   islands             How many islands to run, and how they exchange genomes
+ * @param[in]   settings            How each island runs its plan. If threads is 0, each island gets one thread per CPU it is bound to.
+ *                                  If logPath is set, each island writes its own log, at islandLogPath(). checkpointPath and resumeFrom have to be empty
+ * @param[in]   makeBackend         Called in each island's process after it is forked, with the island's index, to make the backend it develops with, which is then initialized there.
+ *                                  This is where each island picks its device, for example through the environment the driver reads. If empty, each island default constructs its backend
+ * @returns Whether every island ran its plan. If settings would checkpoint or resume, the shared memory can't be mapped, an island can't be forked, or an island fails, for example because its plan can't be run,
+ *          the reason is printed to std::cerr, the other islands are stopped, and genomes and fitness are left unchanged
+ * @note    Bodies aren't returned, as they live in the islands' processes: develop the final genomes again to get them.
+ *          Islands can't be checkpointed and resumed, as their migrants aren't saved
+ * @warning Islands are forked from the calling thread, and a forked process only gets that thread: call this while the process runs no other threads,
+ *          in particular while no Evolver is alive, as its worker pool could hold locks that would then never be released in the islands
+ * @see evolve() for the remaining parameters
+ */
+template <class W, class T, class BodyStorage = SparseBodyStorage, class Backend = OpenGLBackend>
+bool evolveIslands(Genome_t *genomes, int populationSize, int developmentStages, float *fitness, const SelectionPlan<W, T> *plans, float fitnessFunction(Body *body, const T &targets, const W &weights), const IslandSettings &islands, const EvolutionSettings &settings = EvolutionSettings(), const std::function<Backend(int island)> &makeBackend = nullptr, uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)=hammingGeneticDistance){
+    return runIslands<W, T, BodyStorage, Backend>(genomes, populationSize, fitness, plans, islands, settings, makeBackend, [&](Evolver<W, T, BodyStorage, Backend> &evolver, Genome_t *islandGenomes, float *islandFitness, const SelectionPlan<W, T> &plan){
+        return evolver.run(islandGenomes, populationSize, developmentStages, nullptr, islandFitness, plan, fitnessFunction, geneticDistance);
+    });
+}
+
+///Executes a selection plan on each of several populations, measuring each body only once. See the other overload, and evolve() for extractFeatures and scoreFeatures
+template <class W, class T, class BodyStorage = SparseBodyStorage, class Backend = OpenGLBackend>
+bool evolveIslands(Genome_t *genomes, int populationSize, int developmentStages, float *fitness, const SelectionPlan<W, T> *plans, T extractFeatures(Body *body), float scoreFeatures(const T &features, const T &targets, const W &weights), const IslandSettings &islands, const EvolutionSettings &settings = EvolutionSettings(), const std::function<Backend(int island)> &makeBackend = nullptr, uint64_t geneticDistance(const Genome_t& first, const Genome_t& second)=hammingGeneticDistance){
+    return runIslands<W, T, BodyStorage, Backend>(genomes, populationSize, fitness, plans, islands, settings, makeBackend, [&](Evolver<W, T, BodyStorage, Backend> &evolver, Genome_t *islandGenomes, float *islandFitness, const SelectionPlan<W, T> &plan){
+        return evolver.run(islandGenomes, populationSize, developmentStages, nullptr, islandFitness, plan, extractFeatures, scoreFeatures, geneticDistance);
+    });
+}
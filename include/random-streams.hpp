@@ -0,0 +1,91 @@
+#pragma once
+///@file random-streams.hpp
+///@brief Counter-based random numbers, so that every decision of a run draws from its own stream no matter which thread makes it or in what order
+/*! Random numbers are computed with Philox4x32-10 out of the run's seed and a 128 bits counter, instead of being drawn from a shared generator.
+ *  The counter is made of which decision the numbers are for, see StreamId, and of how many numbers that decision has drawn so far.
+ *  A run is thus reproduced exactly by its seed, whatever the number of threads, and resuming only needs the seed and where the run was.
+ */
+
+#include <cstdint>
+
+///The Philox4x32-10 generator from Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"
+struct Philox4x32{
+    static void round(uint32_t counter[4], const uint32_t key[2]){
+        uint64_t first  = uint64_t(0xD2511F53u) * counter[0];
+        uint64_t second = uint64_t(0xCD9E8D57u) * counter[2];
+        uint32_t result[4] = {
+            uint32_t(second >> 32) ^ counter[1] ^ key[0],
+            uint32_t(second),
+            uint32_t(first >> 32) ^ counter[3] ^ key[1],
+            uint32_t(first)
+        };
+        for(int i=0;i<4;++i){
+            counter[i] = result[i];
+        }
+    }
+    ///Turns counter into 4 random numbers
+    static void generate(uint32_t counter[4], uint64_t seed){
+        uint32_t key[2] = {uint32_t(seed), uint32_t(seed >> 32)};
+        for(int i=0;i<10;++i){
+            round(counter, key);
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+    }
+};
+
+///Identifies one decision of a run, such as one pick of a selection substage or the breeding of one child
+struct StreamId{
+    uint32_t stage;
+    uint32_t repeat;
+    ///The index of the substage in its stage, possibly combined with flags telling apart different kinds of decisions of the same substage
+    uint32_t substage;
+    ///Which individual the decision is for, usually its position in the next generation
+    uint32_t slot;
+};
+
+///The random numbers drawn for a single decision. Streams are cheap to create, and should not be shared between threads
+class RandomStream{
+public:
+    RandomStream(uint64_t seed, const StreamId &id) : seed(seed){
+        //Only the low byte of the substage is kept: stages have at most 127 substages, as bit 0x80 tells apart Evolver::breedingStreams and Evolver::steadyStateStreams
+        counter[1] = id.slot;
+        counter[2] = id.repeat;
+        counter[3] = id.stage << 8 | (id.substage & 0xFF);
+    }
+    uint32_t next(){
+        if(used==4){
+            uint32_t block[4] = {blockIndex++, counter[1], counter[2], counter[3]};
+            Philox4x32::generate(block, seed);
+            for(int i=0;i<4;++i){
+                buffer[i] = block[i];
+            }
+            used = 0;
+        }
+        return buffer[used++];
+    }
+    ///@returns A number in [0, 1)
+    double uniform(){
+        uint64_t high = next();
+        uint64_t bits = high << 21 | next() >> 11;
+        return bits * (1./(uint64_t(1) << 53));
+    }
+    ///@returns A number in [0, bound), without modulo bias
+    uint32_t below(uint32_t bound){
+        uint64_t product = uint64_t(next()) * bound;
+        if(uint32_t(product) < bound){
+            uint32_t threshold = -bound % bound;
+            while(uint32_t(product) < threshold){
+                product = uint64_t(next()) * bound;
+            }
+        }
+        return product >> 32;
+    }
+
+private:
+    uint64_t seed;
+    uint32_t counter[4] = {0, 0, 0, 0};
+    uint32_t blockIndex = 0;
+    uint32_t buffer[4];
+    int used = 4;
+};
@@ -0,0 +1,77 @@
+#pragma once
+///@file selection-plan.hpp
+///@brief The description of the genetic algorithm rules evolve() follows
+
+#include <cstdint>
+#include <vector>
+
+///Contains all the necessary data to call a genetic algorithm function
+struct SelectionSubstage{
+    ///One of the genetic algorithm functions
+    enum Type{
+        ROULETTE        = 0b000,
+        LINEAR          = 0b001,
+        EXPONENTIAL     = 0b010,
+        TOURNAMENT      = 0b011,
+        TWO_POINTS_CO   = 0b100,
+        UNIFORM_CO      = 0b101,
+        MUTATE          = 0b110
+    } type;
+    ///Data specific to each genetic algorithm function
+    union{
+        float selectionPressure;
+        float k1;
+        int tournamentSize;
+        float mutationProbability;
+        float desiredGeneticDistance;
+    } param;
+    ///The number of individuals that this substage is to generate
+    int individuals;
+    SelectionSubstage(Type a, int b, int c){type = a; param.tournamentSize = b; individuals=c;}
+    SelectionSubstage(Type a, float b, int c){type = a; param.k1= b; individuals=c;}
+};
+
+///Defines an entire stage of selection, to go from one generation to the next
+template<class W>
+struct SelectionStage{
+    ///The substages that compose this stage
+    ///@note The sum of the individuals member of each substage has to be equal to your population size, or evolve() returns false without running
+    std::vector<SelectionSubstage> substages;
+    ///weights[0] are the starting weights for each quantity defined in SelectionPlan.targets , while weights[1] is added to weights[0] each repeat
+    W weights[2];
+    ///The number of times to repeat this SelectionStage
+    int repeats;
+};
+
+///How a selection plan goes from one population to the next
+enum EvolutionMode{
+    ///Each repeat selects and breeds a whole new generation, and waits for all of its children to be scored before the next repeat
+    GENERATIONAL,
+    /*!
+     * Children are bred one at a time from the population as it is, and each replaces the worst individual once it is scored, so development never waits for selection.
+     * Crossover and mutation substages are chosen for each child in proportion to their individuals, and so are the other substages to pick its parents, or roulette if there are none.
+     * Each repeat breeds SelectionPlan::evaluationsPerRepeat children, and the only times the children in development are waited for are when the weights change and when a checkpoint is due.
+     * @note    Children join in the order they were bred, and each child is bred from the population as it was before the last depth - 1 children,
+     *          depth being the pipeline's, see EvolutionSettings::developmentDepth. Parents are picked from the population as it was ranked every depth evaluations.
+     *          Seeded runs thus depend on the depth, but neither on timing nor, once the depth is set, on the number of threads
+     */
+    STEADY_STATE
+};
+
+///Defines an entire selection plan
+template<class W, class T>
+struct SelectionPlan{
+    ///Individual stages that compose the plan
+    SelectionStage<W> *stages;
+    ///Number of stages
+    int number;
+    ///Whether the fitnesses are to be maximized or minimized. As this has to stay coherent throughout the entire plan, it's defined here
+    bool maximizeFitness;
+    ///The ideal values for the quantities that the fitness function will calculate
+    T targets;
+    ///If not 0, the run only depends on this seed and on the initial genomes passed to evolve(), whatever the number of threads. 0 draws a seed from std::random_device and generates new genomes, as evolve() always did
+    uint64_t seed = 0;
+    EvolutionMode mode = GENERATIONAL;
+    ///How many children a repeat breeds in STEADY_STATE mode, so that weights[1] is added every evaluationsPerRepeat evaluations. 0 means the population size
+    int evaluationsPerRepeat = 0;
+};
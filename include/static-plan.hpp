@@ -0,0 +1,222 @@
+#pragma once
+///@file static-plan.hpp
+///@brief Selection plans described by types, which Evolver runs without dispatching on substage types, and which are checked at compile time
+/*! A SelectionPlan is read at runtime: each substage is a tagged union, its type switched on and its parameter reinterpreted for every substage of every repeat,
+ *  and each pick of a selection substage switches on it again. A StaticPlan lists its stages and their substages as types instead. Each substage is a policy
+ *  with the number of individuals it generates as a template parameter and a parameter of its own type, and Evolver::run() unrolls each stage into a
+ *  straight sequence of loops, each calling its selection, crossover or mutation function directly.
+ *  The individuals of each stage are checked to add up to the population size at compile time.
+ *  A StaticPlan runs exactly like the SelectionPlan toSelectionPlan() turns it into, drawing the same random numbers, which is what STEADY_STATE mode and checkpoints use.
+ *  @code
+ *  using Stage = StaticStage<FitnessWeights, Tournament<60>, TwoPointsCrossover<20>, Mutation<20>>;
+ *  StaticPlan<FitnessWeights, FitnessTargets, 100, Stage> plan(true, targets, Stage(startWeights, weightsStep, 50, {3}, {0.1f}, {0.05f}));
+ *  Evolver<FitnessWeights, FitnessTargets> evolver;
+ *  evolver.run(genomes, developmentStages, bodies, fitness, plan, fitnessFunction);
+ *  @endcode
+ */
+
+#include <genetic-operators.hpp>
+#include <random-streams.hpp>
+#include <selection-plan.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+///Fitness proportionate selection, see SelectionContext::roulette
+template<int Individuals>
+struct Roulette{
+    static_assert(Individuals>=0, "A substage can't generate a negative number of individuals");
+    static constexpr SelectionSubstage::Type type = SelectionSubstage::ROULETTE;
+    static constexpr int individuals = Individuals;
+
+    int pick(SelectionContext &selection, RandomStream *stream) const{
+        return selection.roulette(stream);
+    }
+    SelectionSubstage toSubstage() const{
+        return SelectionSubstage(type, 0, individuals);
+    }
+};
+
+///Linear ranking selection, see SelectionContext::linearRanking
+template<int Individuals>
+struct LinearRanking{
+    static_assert(Individuals>=0, "A substage can't generate a negative number of individuals");
+    static constexpr SelectionSubstage::Type type = SelectionSubstage::LINEAR;
+    static constexpr int individuals = Individuals;
+    float selectionPressure;
+
+    int pick(SelectionContext &selection, RandomStream *stream) const{
+        return selection.linearRanking(selectionPressure, stream);
+    }
+    SelectionSubstage toSubstage() const{
+        return SelectionSubstage(type, selectionPressure, individuals);
+    }
+};
+
+///Exponential ranking selection, see SelectionContext::exponentialRanking
+template<int Individuals>
+struct ExponentialRanking{
+    static_assert(Individuals>=0, "A substage can't generate a negative number of individuals");
+    static constexpr SelectionSubstage::Type type = SelectionSubstage::EXPONENTIAL;
+    static constexpr int individuals = Individuals;
+    float k1;
+
+    int pick(SelectionContext &selection, RandomStream *stream) const{
+        return selection.exponentialRanking(k1, stream);
+    }
+    SelectionSubstage toSubstage() const{
+        return SelectionSubstage(type, k1, individuals);
+    }
+};
+
+///Tournament selection, see SelectionContext::tournament
+template<int Individuals>
+struct Tournament{
+    static_assert(Individuals>=0, "A substage can't generate a negative number of individuals");
+    static constexpr SelectionSubstage::Type type = SelectionSubstage::TOURNAMENT;
+    static constexpr int individuals = Individuals;
+    int tournamentSize;
+
+    int pick(SelectionContext &selection, RandomStream *stream) const{
+        return selection.tournament(tournamentSize, stream);
+    }
+    SelectionSubstage toSubstage() const{
+        return SelectionSubstage(type, tournamentSize, individuals);
+    }
+};
+
+///Two points crossover between a parent picked by roulette and a mate picked by genetic distance, see twoPointsGenomeCrossover
+template<int Individuals>
+struct TwoPointsCrossover{
+    static_assert(Individuals>=0, "A substage can't generate a negative number of individuals");
+    static constexpr SelectionSubstage::Type type = SelectionSubstage::TWO_POINTS_CO;
+    static constexpr int individuals = Individuals;
+    float desiredGeneticDistance;
+
+    static void cross(const Genome_t &first, const Genome_t &second, Genome_t *child, const uint64_t *loci, size_t lociNumber, RandomStream *stream){
+        twoPointsGenomeCrossover(first, second, child, loci, lociNumber, stream);
+    }
+    SelectionSubstage toSubstage() const{
+        return SelectionSubstage(type, desiredGeneticDistance, individuals);
+    }
+};
+
+///Uniform crossover between a parent picked by roulette and a mate picked by genetic distance, see uniformGenomeCrossover
+template<int Individuals>
+struct UniformCrossover{
+    static_assert(Individuals>=0, "A substage can't generate a negative number of individuals");
+    static constexpr SelectionSubstage::Type type = SelectionSubstage::UNIFORM_CO;
+    static constexpr int individuals = Individuals;
+    float desiredGeneticDistance;
+
+    static void cross(const Genome_t &first, const Genome_t &second, Genome_t *child, const uint64_t *loci, size_t lociNumber, RandomStream *stream){
+        uniformGenomeCrossover(first, second, child, loci, lociNumber, stream);
+    }
+    SelectionSubstage toSubstage() const{
+        return SelectionSubstage(type, desiredGeneticDistance, individuals);
+    }
+};
+
+///Mutation of distinct individuals picked at random, see mutateGenomeFields
+template<int Individuals>
+struct Mutation{
+    static_assert(Individuals>=0, "A substage can't generate a negative number of individuals");
+    static constexpr SelectionSubstage::Type type = SelectionSubstage::MUTATE;
+    static constexpr int individuals = Individuals;
+    float mutationProbability;
+
+    SelectionSubstage toSubstage() const{
+        return SelectionSubstage(type, mutationProbability, individuals);
+    }
+};
+
+///The typed counterpart of SelectionStage, its substages being policies such as Tournament or Mutation
+template<class W, class... Substages>
+struct StaticStage{
+    static_assert(sizeof...(Substages) > 0, "A stage needs at least one substage");
+    //Breeding streams flag the substage index with 0x80, see Evolver
+    static_assert(sizeof...(Substages) < 128, "A stage can't have more than 127 substages");
+    ///How many individuals the stage generates, which has to be the population size
+    static constexpr int individuals = (0 + ... + Substages::individuals);
+
+    ///@returns The slot of the next generation the substage at index substage starts filling
+    static constexpr int firstSlot(size_t substage){
+        constexpr int counts[] = {Substages::individuals...};
+        int slot = 0;
+        for(size_t s=0;s<substage;++s){
+            slot += counts[s];
+        }
+        return slot;
+    }
+
+    ///@param[in]   start, step    weights[0] and weights[1] of SelectionStage
+    StaticStage(const W &start, const W &step, int repeats, const Substages&... substages) : substages(substages...), repeats(repeats){
+        weights[0] = start;
+        weights[1] = step;
+    }
+
+    std::tuple<Substages...> substages;
+    W weights[2];
+    int repeats;
+
+    SelectionStage<W> toSelectionStage() const{
+        SelectionStage<W> stage;
+        std::apply([&stage](const Substages&... substages){
+            (stage.substages.push_back(substages.toSubstage()), ...);
+        }, substages);
+        stage.weights[0] = weights[0];
+        stage.weights[1] = weights[1];
+        stage.repeats = repeats;
+        return stage;
+    }
+};
+
+/*!
+ * @brief   The typed counterpart of SelectionPlan, for plans known at compile time
+ * @tparam  PopulationSize  The size of the population the plan runs on, which every stage has to generate
+ * @tparam  Stages          StaticStage specializations, in the order they run
+ */
+template<class W, class T, int PopulationSize, class... Stages>
+struct StaticPlan{
+    static_assert(PopulationSize > 0, "The population can't be empty");
+    static_assert(sizeof...(Stages) > 0, "A plan needs at least one stage");
+    static_assert(((Stages::individuals==PopulationSize) && ...), "The individuals of the substages of each stage have to add up to the population size");
+    static constexpr int populationSize = PopulationSize;
+    static constexpr int number = sizeof...(Stages);
+
+    StaticPlan(bool maximizeFitness, const T &targets, const Stages&... stages) : stages(stages...), maximizeFitness(maximizeFitness), targets(targets){}
+
+    std::tuple<Stages...> stages;
+    ///See SelectionPlan for these
+    bool maximizeFitness;
+    T targets;
+    uint64_t seed = 0;
+    EvolutionMode mode = GENERATIONAL;
+    int evaluationsPerRepeat = 0;
+
+    ///@returns The equivalent runtime plan, whose stages are kept in storage
+    SelectionPlan<W, T> toSelectionPlan(std::vector<SelectionStage<W>> *storage) const{
+        storage->clear();
+        std::apply([storage](const Stages&... stages){
+            (storage->push_back(stages.toSelectionStage()), ...);
+        }, stages);
+        SelectionPlan<W, T> plan{storage->data(), number, maximizeFitness, targets};
+        plan.seed = seed;
+        plan.mode = mode;
+        plan.evaluationsPerRepeat = evaluationsPerRepeat;
+        return plan;
+    }
+    ///Calls visit with the stage at index stage, as its own type
+    template<class Visit>
+    void visitStage(int stage, Visit visit) const{
+        visitStage(stage, visit, std::index_sequence_for<Stages...>());
+    }
+
+private:
+    template<class Visit, size_t... S>
+    void visitStage(int stage, Visit &visit, std::index_sequence<S...>) const{
+        ((stage==int(S) ? visit(std::get<S>(stages)) : void()), ...);
+    }
+};
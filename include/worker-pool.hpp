@@ -0,0 +1,109 @@
+#pragma once
+///@file worker-pool.hpp
+///@brief A fixed set of threads that evolve() hands its CPU work to
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///Runs tasks on a fixed number of threads. Each task is told the index of the thread running it, so it can use per-thread scratch space
+class WorkerPool{
+public:
+    ///@param[in]   threads How many threads to start, 0 picks one per hardware thread
+    explicit WorkerPool(int threads = 0){
+        if(threads<=0){
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for(int i=0;i<threads;++i){
+            workers.emplace_back(&WorkerPool::work, this, i);
+        }
+    }
+    ~WorkerPool(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskQueued.notify_all();
+        for(auto &worker : workers){
+            worker.join();
+        }
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ///@returns The number of threads, tasks are passed a thread index in [0, size())
+    int size() const{
+        return workers.size();
+    }
+    ///Queues a task, which will be called with the index of the thread running it
+    void submit(std::function<void(int)> task){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+            ++unfinished;
+        }
+        taskQueued.notify_one();
+    }
+    ///Waits until every task submitted so far has returned
+    void wait(){
+        std::unique_lock<std::mutex> lock(mutex);
+        taskFinished.wait(lock, [this]{return unfinished==0;});
+    }
+    /*!
+     * @brief   Calls task(index, thread) for every index in [0, count) and waits for all of them
+     * Indices are handed out a few at a time to whichever thread is free, so uneven tasks still keep every thread busy.
+     * Which thread runs which index changes from run to run: as long as each index only writes its own results, they don't depend on it.
+     */
+    template<class Task>
+    void parallelFor(int count, Task task){
+        if(count<=0){
+            return;
+        }
+        std::atomic<int> next(0);
+        int chunk = std::max(1, count/(8*size()));
+        int threads = std::min(size(), (count + chunk - 1)/chunk);
+        for(int i=0;i<threads;++i){
+            submit([&next, &task, count, chunk](int thread){
+                for(int first=next.fetch_add(chunk);first<count;first=next.fetch_add(chunk)){
+                    int last = std::min(count, first + chunk);
+                    for(int index=first;index<last;++index){
+                        task(index, thread);
+                    }
+                }
+            });
+        }
+        wait();
+    }
+
+private:
+    void work(int thread){
+        std::unique_lock<std::mutex> lock(mutex);
+        for(;;){
+            taskQueued.wait(lock, [this]{return stopping || !tasks.empty();});
+            if(tasks.empty()){
+                return;
+            }
+            std::function<void(int)> task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            task(thread);
+            lock.lock();
+            if(--unfinished==0){
+                taskFinished.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void(int)>> tasks;
+    int unfinished = 0;
+    std::mutex mutex;
+    std::condition_variable taskQueued;
+    std::condition_variable taskFinished;
+    bool stopping = false;
+};
@@ -0,0 +1,76 @@
+///@file body-storage-test.cpp
+///@brief Checks that body storages give back exactly the grids they were given, and leave the grid they expand into clean
+
+#include <body-storage.hpp>
+#include <test-support.hpp>
+#include <cstdint>
+#include <vector>
+
+///Stores grid, expands it into a zeroed grid, and checks it comes back unchanged and that erase() zeroes it again
+template<class BodyStorage>
+bool roundTrips(const std::vector<uint8_t> &grid){
+    BodyStorage storage;
+    storage.store(grid.data());
+    std::vector<uint8_t> expanded(bodyGridVolume);
+    storage.expand(expanded.data());
+    bool same = expanded==grid;
+    uint64_t cells = 0;
+    for(uint8_t voxel : grid){
+        cells += voxel!=0;
+    }
+    storage.erase(expanded.data());
+    for(uint8_t voxel : expanded){
+        if(voxel){
+            return false;
+        }
+    }
+    return same && storage.occupiedCells()==cells;
+}
+
+///Fills an axis-aligned box of grid with a pattern of non-zero values
+void fillBox(std::vector<uint8_t> *grid, int low, int high){
+    for(int z=low;z<high;++z){
+        for(int y=low;y<high;++y){
+            for(int x=low;x<high;++x){
+                (*grid)[x + 256*y + 256*256*z] = 1 + (x ^ y ^ z)%4;
+            }
+        }
+    }
+}
+
+template<class BodyStorage>
+void checkStorage(const char *name){
+    std::vector<std::vector<uint8_t>> grids;
+    grids.emplace_back(bodyGridVolume);
+    //Runs touching both ends of the grid, and runs shorter than the words empty space is skipped by
+    grids.emplace_back(bodyGridVolume);
+    grids.back().front() = 1;
+    grids.back().back() = 2;
+    grids.back()[7] = grids.back()[8] = grids.back()[9] = 3;
+    grids.emplace_back(bodyGridVolume);
+    fillBox(&grids.back(), 100, 140);
+    grids.emplace_back(bodyGridVolume);
+    uint32_t state = 12345;
+    for(uint32_t i=0;i<bodyGridVolume;++i){
+        state = state*1664525u + 1013904223u;
+        if(state >> 26 == 0){
+            grids.back()[i] = 1 + (state >> 8)%4;
+        }
+    }
+    bool passed = true;
+    for(const std::vector<uint8_t> &grid : grids){
+        passed = passed && roundTrips<BodyStorage>(grid);
+    }
+    check(passed, name);
+}
+
+int main(){
+    checkStorage<DenseBodyStorage>("dense storage gives back the grids it stored");
+    checkStorage<SparseBodyStorage>("sparse storage gives back the grids it stored");
+    std::vector<uint8_t> grid(bodyGridVolume);
+    fillBox(&grid, 120, 136);
+    SparseBodyStorage sparse;
+    sparse.store(grid.data());
+    check(sparse.memoryFootprint() < bodyGridVolume/64, "sparse storage takes memory after the body, not the grid");
+    return testResult();
+}
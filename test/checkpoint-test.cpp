@@ -0,0 +1,220 @@
+///@file checkpoint-test.cpp
+///@brief Checks the checkpoint file format, that checkpoints which don't fit the plan or were written by another one are rejected, and that a run resumed from the checkpoint of a finished plan returns the population it was written with
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const int populationSize = 16;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+const std::string checkpointPath = "checkpoint-test.ckpt";
+
+///Develops genome on a fresh backend, and keeps its body the way checkpoints save it
+SparseBodyStorage developed(Genome_t genome){
+    HeadlessBackend backend;
+    backend.initialize();
+    std::vector<uint8_t> grid(bodyGridVolume);
+    backend.load(&genome);
+    backend.develop(developmentStages);
+    backend.birth(grid.data());
+    backend.release();
+    SparseBodyStorage body;
+    body.store(grid.data());
+    return body;
+}
+
+bool sameCheckpoint(const Checkpoint<TestWeights> &first, const Checkpoint<TestWeights> &second){
+    bool same = first.stage==second.stage && first.repeat==second.repeat && first.weightsVersion==second.weightsVersion && !std::memcmp(&first.previousWeights, &second.previousWeights, sizeof(TestWeights));
+    same = same && first.seed==second.seed && first.planFingerprint==second.planFingerprint && first.fitness==second.fitness && first.genomes.size()==second.genomes.size() && first.bodies.size()==second.bodies.size();
+    for(size_t k=0;same && k<first.genomes.size();++k){
+        same = !std::memcmp(&first.genomes[k], &second.genomes[k], sizeof(Genome_t));
+    }
+    for(size_t k=0;same && k<first.bodies.size();++k){
+        same = first.bodies[k].runs==second.bodies[k].runs && first.bodies[k].voxels==second.bodies[k].voxels;
+    }
+    return same;
+}
+
+void checkFormat(){
+    Checkpoint<TestWeights> written;
+    written.stage = 1;
+    written.repeat = 2;
+    written.previousWeights = {0.5f, 0.25f};
+    written.weightsVersion = 7;
+    written.seed = 0x123456789ull;
+    written.planFingerprint = 0xfedcba987654321ull;
+    for(int k=0;k<4;++k){
+        written.genomes.push_back(testGenome(10, k));
+        written.fitness.push_back(k*0.5f);
+    }
+    Checkpoint<TestWeights> read;
+    check(writeCheckpoint(checkpointPath, written) && readCheckpoint(checkpointPath, &read) && sameCheckpoint(written, read), "a checkpoint without bodies reads back as written");
+    for(auto &genome : written.genomes){
+        written.bodies.push_back(developed(genome));
+    }
+    check(writeCheckpoint(checkpointPath, written) && readCheckpoint(checkpointPath, &read) && sameCheckpoint(written, read), "a checkpoint with bodies reads back as written");
+    std::string bytes;
+    {
+        std::ifstream file(checkpointPath, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::ofstream(checkpointPath, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size() - 1);
+    bool truncated = !readCheckpoint(checkpointPath, &read);
+    std::ofstream(checkpointPath, std::ios::binary | std::ios::trunc).write("EVOCKPX", 8);
+    check(truncated && !readCheckpoint(checkpointPath, &read) && !readCheckpoint("missing-" + checkpointPath, &read), "truncated, foreign and missing files are rejected");
+    //The population size follows the magic and the header
+    auto withPopulation = [&bytes](int32_t populationSize){
+        std::string corrupt = bytes;
+        std::memcpy(&corrupt[8 + 4*sizeof(uint32_t)], &populationSize, sizeof(populationSize));
+        std::ofstream(checkpointPath, std::ios::binary | std::ios::trunc).write(corrupt.data(), corrupt.size());
+    };
+    withPopulation(INT32_MAX);
+    bool oversized = !readCheckpoint(checkpointPath, &read);
+    withPopulation(5);
+    oversized = oversized && !readCheckpoint(checkpointPath, &read);
+    withPopulation(4);
+    check(oversized && !readCheckpoint(checkpointPath, &read, 5) && readCheckpoint(checkpointPath, &read, 4) && sameCheckpoint(written, read), "population sizes beyond the file or the plan are rejected");
+    {
+        CheckpointWriter<TestWeights> writer(checkpointPath);
+        written.bodies.clear();
+        writer.submit(written, [](Checkpoint<TestWeights> *checkpoint){checkpoint->repeat = 3;});
+    }
+    written.repeat = 3;
+    check(readCheckpoint(checkpointPath, &read) && sameCheckpoint(written, read), "CheckpointWriter completes and writes what was submitted");
+}
+
+///Runs plan, checkpointing it, and then resumes from the checkpoint of the finished plan
+void checkResume(bool checkpointBodies, const char *name){
+    SelectionStage<TestWeights> stages[2];
+    for(auto &stage : stages){
+        stage.weights[0] = {1.f, 0.f};
+        stage.weights[1] = {0.f, 0.25f};
+        stage.repeats = 2;
+        stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+        stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+        stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+    }
+    SelectionPlan<TestWeights, TestTargets> plan{stages, 2, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(11, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    settings.checkpointPath = checkpointPath;
+    settings.checkpointInterval = 3;
+    settings.checkpointBodies = checkpointBodies;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    Checkpoint<TestWeights> checkpoint;
+    bool passed = readCheckpoint(checkpointPath, &checkpoint) && checkpoint.stage==2 && checkpoint.repeat==0 && checkpoint.fitness==fitness;
+    passed = passed && checkpoint.bodies.size()==size_t(checkpointBodies ? populationSize : 0);
+    for(int k=0;passed && k<populationSize;++k){
+        passed = !std::memcmp(&checkpoint.genomes[k], &genomes[k], sizeof(Genome_t));
+    }
+
+    std::vector<Genome_t> resumedGenomes(populationSize);
+    std::vector<float> resumedFitness(populationSize);
+    TestBodies resumedBodies(populationSize, maxCells);
+    settings.checkpointPath.clear();
+    settings.resumeFrom = checkpointPath;
+    passed = passed && evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(resumedGenomes.data(), populationSize, developmentStages, resumedBodies.bodies.data(), resumedFitness.data(), plan, testFitness, myGeneticDistance, settings);
+    passed = passed && resumedFitness==fitness;
+    for(int k=0;passed && k<populationSize;++k){
+        passed = !std::memcmp(&resumedGenomes[k], &genomes[k], sizeof(Genome_t)) && sameBody(resumedBodies.bodies[k], bodies.bodies[k]);
+    }
+    check(passed, name);
+}
+
+///Resumes from checkpoints that don't fit the plan or the population, or were written by another plan, which mustn't run nor change anything
+void checkValidation(){
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    stage.weights[1] = {0.f, 0.f};
+    stage.repeats = 2;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/2);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(12, i));
+    }
+    std::vector<Genome_t> initial = genomes;
+    std::vector<float> fitness(populationSize, -1.f);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    settings.resumeFrom = checkpointPath;
+    //The plan the checkpoints are written by
+    const SelectionPlan<TestWeights, TestTargets> *writtenBy = &plan;
+    auto rejected = [&](int stage, int repeat, int individuals){
+        Checkpoint<TestWeights> checkpoint;
+        checkpoint.stage = stage;
+        checkpoint.repeat = repeat;
+        checkpoint.planFingerprint = planFingerprint(*writtenBy, stage, repeat);
+        checkpoint.previousWeights = {1.f, 0.f};
+        checkpoint.genomes.assign(initial.begin(), initial.begin() + individuals);
+        checkpoint.fitness.assign(individuals, 0.f);
+        writeCheckpoint(checkpointPath, checkpoint);
+        return !evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    };
+    //std::cerr is silenced while the errors are expected
+    std::streambuf *errors = std::cerr.rdbuf(nullptr);
+    bool passed = rejected(0, 0, populationSize/2) && rejected(1, 1, populationSize) && rejected(2, 0, populationSize) && rejected(0, 2, populationSize) && rejected(-1, 0, populationSize);
+    SelectionStage<TestWeights> otherStage = stage;
+    otherStage.substages[1].param.mutationProbability = 0.1f;
+    SelectionPlan<TestWeights, TestTargets> other = plan;
+    other.stages = &otherStage;
+    writtenBy = &other;
+    bool otherRejected = rejected(0, 1, populationSize) && rejected(1, 0, populationSize);
+    other = plan;
+    other.seed = 7;
+    otherRejected = otherRejected && rejected(0, 1, populationSize);
+    other = plan;
+    other.maximizeFitness = false;
+    otherRejected = otherRejected && rejected(1, 0, populationSize);
+    otherStage = stage;
+    otherStage.repeats = 3;
+    other = plan;
+    other.stages = &otherStage;
+    otherRejected = otherRejected && rejected(1, 0, populationSize);
+    writtenBy = &plan;
+    settings.resumeFrom = "missing-" + checkpointPath;
+    passed = passed && !evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    std::cerr.rdbuf(errors);
+    passed = passed && fitness==std::vector<float>(populationSize, -1.f) && !std::memcmp(genomes.data(), initial.data(), populationSize*sizeof(Genome_t));
+    check(passed, "checkpoints that don't fit the plan are rejected, nothing run");
+    check(otherRejected, "checkpoints written by another plan are rejected");
+    settings.resumeFrom = checkpointPath;
+    passed = !rejected(0, 1, populationSize) && !rejected(1, 0, populationSize);
+    //The finished plan resumed with a stage added after it
+    SelectionStage<TestWeights> lengthened[2] = {stage, stage};
+    SelectionPlan<TestWeights, TestTargets> longer = plan;
+    longer.stages = lengthened;
+    longer.number = 2;
+    Checkpoint<TestWeights> finished;
+    finished.stage = 1;
+    finished.previousWeights = {1.f, 0.f};
+    finished.planFingerprint = planFingerprint(plan, 1, 0);
+    finished.genomes = initial;
+    finished.fitness.assign(populationSize, 0.f);
+    writeCheckpoint(checkpointPath, finished);
+    passed = passed && evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), longer, testFitness, myGeneticDistance, settings);
+    check(passed, "checkpoints within the plan, or at its end, are resumed, even with stages added after them");
+}
+
+int main(){
+    checkFormat();
+    checkValidation();
+    checkResume(false, "resuming a finished plan returns its population, developed again");
+    checkResume(true, "resuming a finished plan returns its population, bodies included");
+    std::remove(checkpointPath.c_str());
+    return testResult();
+}
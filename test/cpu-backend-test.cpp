@@ -0,0 +1,89 @@
+///@file cpu-backend-test.cpp
+///@brief Checks that CpuBackend develops each genome into a body that only depends on the genome, whatever was developed before it, and that evolve() runs on it
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <vector>
+
+const int populationSize = 16;
+const int developmentStages = 6;
+//CpuBackend bodies grow by at most one voxel in each direction per stage
+const uint64_t maxCells = 13*13*13;
+
+///@returns The grid genome develops into on backend
+std::vector<uint8_t> develop(CpuBackend *backend, Genome_t genome){
+    std::vector<uint8_t> grid(bodyGridVolume);
+    backend->load(&genome);
+    backend->develop(developmentStages);
+    backend->birth(grid.data());
+    return grid;
+}
+
+///@returns The grid genome develops into on a fresh backend with the given number of threads
+std::vector<uint8_t> developed(Genome_t genome, int threads){
+    CpuBackend backend;
+    backend.threads = threads;
+    backend.initialize();
+    std::vector<uint8_t> grid = develop(&backend, genome);
+    backend.release();
+    return grid;
+}
+
+int main(){
+    bool same = true;
+    bool grown = true;
+    for(int k=0;k<4;++k){
+        std::vector<uint8_t> serial = developed(testGenome(15, k), 1);
+        same = same && developed(testGenome(15, k), 4)==serial;
+        uint64_t cells = 0;
+        bool contained = true;
+        for(int z=0;z<256;++z){
+            for(int y=0;y<256;++y){
+                for(int x=0;x<256;++x){
+                    if(serial[x + 256*y + 65536*z]){
+                        ++cells;
+                        contained = contained && std::abs(x - 128)<=developmentStages && std::abs(y - 128)<=developmentStages && std::abs(z - 128)<=developmentStages;
+                    }
+                }
+            }
+        }
+        grown = grown && cells>1 && contained;
+    }
+    check(same, "a body doesn't depend on the number of threads developing it");
+    check(grown, "bodies grow from the center by at most a voxel per stage");
+    CpuBackend used;
+    used.initialize();
+    bool independent = true;
+    for(int k=0;k<4;++k){
+        develop(&used, testGenome(15, k + 1));
+        independent = independent && develop(&used, testGenome(15, k))==developed(testGenome(15, k), 1);
+    }
+    used.release();
+    check(independent, "a genome develops the same after another genome");
+
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    stage.weights[1] = {0.f, 0.f};
+    stage.repeats = 2;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::UNIFORM_CO, 0.5f, populationSize/4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.1f}};
+    plan.seed = 12;
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(16, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, CpuBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    bool passed = true;
+    for(int i=0;i<populationSize;++i){
+        passed = passed && bodies.bodies[i].cellsNumber>1 && fitness[i]==testFitness(&bodies.bodies[i], plan.targets, stage.weights[0]);
+        passed = passed && developsInto<CpuBackend>(genomes[i], developmentStages, bodies.bodies[i], maxCells);
+    }
+    check(passed, "evolve() on CpuBackend returns the bodies of its genomes, scored");
+    return testResult();
+}
@@ -0,0 +1,113 @@
+///@file evolution-statistics-test.cpp
+///@brief Checks PhaseScope, and the statistics evolve() reports for each generation
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int populationSize = 16;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+const std::string checkpointPath = "evolution-statistics-test.ckpt";
+
+void checkPhaseScope(){
+    PhaseTimes times;
+    {
+        PhaseScope scope(&times, PhaseTimes::FITNESS);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    {
+        PhaseScope untimed(nullptr, PhaseTimes::FITNESS);
+    }
+    bool othersEmpty = true;
+    for(int i=0;i<PhaseTimes::FITNESS;++i){
+        othersEmpty = othersEmpty && times.phases[i].wall==0 && times.phases[i].cpu==0;
+    }
+    check(times.phases[PhaseTimes::FITNESS].wall>=0.02 && times.phases[PhaseTimes::FITNESS].cpu<0.02 && othersEmpty, "PhaseScope adds wall and CPU time to its phase only");
+}
+
+int main(){
+    checkPhaseScope();
+
+    const int repeats = 3;
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    stage.weights[1] = {0.f, 0.25f};
+    stage.repeats = repeats;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    plan.seed = 11;
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(14, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    settings.threads = 2;
+    settings.printProgress = false;
+    std::vector<GenerationStatistics> generations;
+    settings.statistics = [&generations](const GenerationStatistics &statistics){generations.push_back(statistics);};
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+
+    bool ordered = generations.size()==repeats + 1 && generations[0].stage==-1 && generations[0].repeat==-1;
+    for(int j=0;ordered && j<repeats;++j){
+        ordered = generations[j + 1].stage==0 && generations[j + 1].repeat==j;
+    }
+    check(ordered, "one report for the initial population, then one per repeat");
+    bool counted = ordered && generations[0].bred==0 && generations[0].developed==populationSize;
+    for(int j=1;counted && j<=repeats;++j){
+        const GenerationStatistics &generation = generations[j];
+        counted = generation.bred==populationSize/2 && generation.developed<=generation.bred;
+        //From the second repeat on, the weights change and whatever wasn't just developed is scored again
+        counted = counted && (j==1 || generation.rescored==populationSize - generation.developed);
+    }
+    check(counted, "bred, developed and rescored counts add up");
+    bool timed = ordered;
+    for(int j=0;timed && j<=repeats;++j){
+        const GenerationStatistics &generation = generations[j];
+        timed = generation.total.wall>0 && generation.phases.phases[PhaseTimes::DEVELOPMENT].wall>0 && generation.phases.phases[PhaseTimes::FITNESS].wall>0;
+        timed = timed && (j==0 || generation.phases.phases[PhaseTimes::SELECTION].wall>0);
+    }
+    check(timed, "every generation times its phases");
+    double sum = 0;
+    for(float f : fitness){
+        sum += f;
+    }
+    check(ordered && generations.back().bestFitness==*std::max_element(fitness.begin(), fitness.end()) && generations.back().meanFitness==float(sum/populationSize), "the last report describes the returned fitnesses");
+    std::ostringstream printed;
+    writeGenerationStatistics(generations.back(), printed);
+    std::string line = printed.str();
+    //printGenerationStatistics is meant to be assigned as is
+    std::function<void(const GenerationStatistics&)> printer = printGenerationStatistics;
+    check(line.find("Stage 1, repeat 3:")==0 && std::count(line.begin(), line.end(), '\n')==1 && printer, "writeGenerationStatistics writes one line per generation");
+    std::ostringstream formatted;
+    formatted<<std::scientific<<std::setprecision(7);
+    writeGenerationStatistics(generations.back(), formatted);
+    std::ios::fmtflags flags = formatted.flags();
+    formatted.str("");
+    formatted<<0.5;
+    check((flags & std::ios::floatfield)==std::ios::scientific && formatted.precision()==7 && formatted.str()=="5.0000000e-01", "writeGenerationStatistics restores the stream's formatting");
+
+    //Resuming the finished plan with its bodies develops nothing
+    settings.checkpointPath = checkpointPath;
+    settings.checkpointBodies = true;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    settings.checkpointPath.clear();
+    settings.resumeFrom = checkpointPath;
+    generations.clear();
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    std::remove(checkpointPath.c_str());
+    check(generations.size()==1 && generations[0].developed==0, "a run resumed with bodies reports none developed");
+    return testResult();
+}
@@ -0,0 +1,144 @@
+///@file evolver-test.cpp
+///@brief Checks that one Evolver runs several plans in a row, with different population sizes, development stages and scorers, as fresh evolve() calls would, and rejects plans that have no stages, don't fill the population, have too many substages or invalid parameters, can't be developed, or are run from another thread than the Evolver's
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 12*12*12;
+
+TestTargets extractCells(Body *body){
+    return TestTargets{body->cellsNumber/1000.f};
+}
+
+float scoreCells(const TestTargets &features, const TestTargets &targets, const TestWeights &weights){
+    return weights.cellsFactor * std::exp(-std::fabs(features.cells - targets.cells)) + weights.offset;
+}
+
+///Runs a small plan on evolver, and checks that each returned body is what its genome develops into and each fitness that body's
+void checkRun(Evolver<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend> *evolver, int populationSize, int developmentStages, bool features, const char *name){
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    stage.weights[1] = {0.f, 0.25f};
+    stage.repeats = 2;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(12, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    if(features){
+        evolver->run(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, extractCells, scoreCells, myGeneticDistance);
+    } else{
+        evolver->run(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance);
+    }
+    TestWeights last = stage.weights[0] + stage.weights[1];
+    bool passed = true;
+    for(int i=0;i<populationSize;++i){
+        passed = passed && developsInto<HeadlessBackend>(genomes[i], developmentStages, bodies.bodies[i], maxCells);
+        float expected = features ? scoreCells(extractCells(&bodies.bodies[i]), plan.targets, last) : testFitness(&bodies.bodies[i], plan.targets, last);
+        passed = passed && fitness[i]==expected;
+    }
+    check(passed, name);
+}
+
+///Runs a plan of one stage made of substages, which mustn't run nor change anything
+bool rejected(Evolver<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend> *evolver, int populationSize, std::vector<SelectionSubstage> substages){
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    stage.weights[1] = {0.f, 0.f};
+    stage.repeats = 2;
+    stage.substages = std::move(substages);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(3, i));
+    }
+    std::vector<Genome_t> initial = genomes;
+    std::vector<float> fitness(populationSize, -1.f);
+    TestBodies bodies(populationSize, maxCells);
+    bool ran = evolver->run(genomes.data(), populationSize, 4, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance);
+    return !ran && fitness==std::vector<float>(populationSize, -1.f) && !std::memcmp(genomes.data(), initial.data(), populationSize*sizeof(Genome_t));
+}
+
+///A backend without the device it develops on
+struct UnavailableBackend : HeadlessBackend{
+    bool initialize(){
+        return false;
+    }
+};
+
+int main(){
+    EvolutionSettings settings;
+    settings.threads = 2;
+    Evolver<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend> evolver(settings);
+    checkRun(&evolver, 16, 4, false, "a first run returns matching genomes, bodies and fitnesses");
+    checkRun(&evolver, 32, 4, false, "a run on a larger population does too");
+    //Individuals cached by the previous runs developed for 4 stages, and mustn't come back
+    checkRun(&evolver, 8, 5, false, "a run with other development stages does too");
+    checkRun(&evolver, 16, 5, true, "a run measuring features does too");
+    evolver.settings.genomeCacheBudget = 0;
+    checkRun(&evolver, 16, 5, false, "a run without the genome cache does too");
+    //std::cerr is silenced while the errors are expected
+    std::streambuf *errors = std::cerr.rdbuf(nullptr);
+    bool passed = rejected(&evolver, 8, {{SelectionSubstage::TOURNAMENT, 2, 2}, {SelectionSubstage::MUTATE, 0.05f, 2}});
+    passed = passed && rejected(&evolver, 8, {{SelectionSubstage::TOURNAMENT, 2, 6}, {SelectionSubstage::MUTATE, 0.05f, 6}});
+    passed = passed && rejected(&evolver, 8, {}) && rejected(&evolver, 8, {{SelectionSubstage::TOURNAMENT, 2, 10}, {SelectionSubstage::MUTATE, 0.05f, -2}});
+    bool pressure = rejected(&evolver, 8, {{SelectionSubstage::LINEAR, 0.f, 4}, {SelectionSubstage::MUTATE, 0.05f, 4}});
+    pressure = pressure && rejected(&evolver, 8, {{SelectionSubstage::LINEAR, -1.f, 4}, {SelectionSubstage::MUTATE, 0.05f, 4}});
+    pressure = pressure && rejected(&evolver, 8, {{SelectionSubstage::EXPONENTIAL, 1.5f, 4}, {SelectionSubstage::MUTATE, 0.05f, 4}});
+    pressure = pressure && rejected(&evolver, 8, {{SelectionSubstage::EXPONENTIAL, -0.1f, 4}, {SelectionSubstage::MUTATE, 0.05f, 4}});
+    //genetic-algorithm-- accepted any positive linear pressure
+    pressure = pressure && !rejected(&evolver, 8, {{SelectionSubstage::LINEAR, 3.f, 4}, {SelectionSubstage::MUTATE, 0.05f, 4}});
+    //Substage 128 would draw from the streams of substage 0
+    std::vector<SelectionSubstage> many(128, SelectionSubstage(SelectionSubstage::MUTATE, 0.05f, 0));
+    many[0] = SelectionSubstage(SelectionSubstage::TOURNAMENT, 2, 4);
+    many[1] = SelectionSubstage(SelectionSubstage::MUTATE, 0.05f, 4);
+    bool tooMany = rejected(&evolver, 8, many);
+    many.pop_back();
+    bool allowed = !rejected(&evolver, 8, many);
+    std::vector<Genome_t> genomes(8, testGenome(4, 0));
+    std::vector<float> fitness(8, -1.f);
+    SelectionStage<TestWeights> stage;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 2, 4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, 4);
+    SelectionPlan<TestWeights, TestTargets> empty{&stage, 0, true, {0.5f}};
+    bool emptyRejected = !evolver.run(genomes.data(), 8, 4, nullptr, fitness.data(), empty, testFitness, myGeneticDistance);
+    empty.number = 1;
+    empty.stages = nullptr;
+    emptyRejected = emptyRejected && !evolver.run(genomes.data(), 8, 4, nullptr, fitness.data(), empty, testFitness, myGeneticDistance);
+    emptyRejected = emptyRejected && fitness==std::vector<float>(8, -1.f);
+    //The backend was initialized on this thread, so runs from any other are refused
+    SelectionStage<TestWeights> runnable = stage;
+    runnable.weights[0] = {1.f, 0.f};
+    runnable.weights[1] = {0.f, 0.f};
+    runnable.repeats = 1;
+    SelectionPlan<TestWeights, TestTargets> runnablePlan{&runnable, 1, true, {0.5f}};
+    bool ranElsewhere = true;
+    std::thread elsewhere([&]{
+        ranElsewhere = evolver.run(genomes.data(), 8, 4, nullptr, fitness.data(), runnablePlan, testFitness, myGeneticDistance);
+    });
+    elsewhere.join();
+    bool threadRejected = !ranElsewhere && fitness==std::vector<float>(8, -1.f);
+    std::cerr.rdbuf(errors);
+    check(passed, "plans generating more or less than the population are rejected");
+    check(tooMany && allowed, "stages of more than 127 substages are rejected");
+    check(emptyRejected, "plans without stages are rejected");
+    check(pressure, "ranking parameters giving negative or no weights are rejected, and only them");
+    check(threadRejected, "runs from another thread than the Evolver's are rejected");
+    checkRun(&evolver, 8, 4, false, "a run after rejected ones still returns matching results");
+
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    errors = std::cerr.rdbuf(nullptr);
+    bool ran = evolve<TestWeights, TestTargets, SparseBodyStorage, UnavailableBackend>(genomes.data(), 8, 4, nullptr, fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    std::cerr.rdbuf(errors);
+    check(!ran && fitness==std::vector<float>(8, -1.f), "a backend that can't be initialized fails runs, not the process");
+    return testResult();
+}
@@ -0,0 +1,59 @@
+///@file feature-scoring-test.cpp
+///@brief Checks the feature-caching evolve() overload: each body is measured once, and survivors are scored again with the weights of the last repeat
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <atomic>
+#include <vector>
+
+const int populationSize = 24;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+
+std::atomic<int> extractions(0);
+
+TestTargets extractCells(Body *body){
+    ++extractions;
+    return TestTargets{body->cellsNumber/1000.f};
+}
+
+float scoreCells(const TestTargets &features, const TestTargets &targets, const TestWeights &weights){
+    return weights.cellsFactor * std::exp(-std::fabs(features.cells - targets.cells)) + weights.offset;
+}
+
+int main(){
+    const int repeats = 3;
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    //Survivors have to be scored again every repeat
+    stage.weights[1] = {0.f, 0.25f};
+    stage.repeats = repeats;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(5, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    settings.threads = 2;
+    GenomeCacheStatistics cacheStatistics;
+    settings.genomeCacheStatistics = &cacheStatistics;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, extractCells, scoreCells, myGeneticDistance, settings);
+    //The initial population, and then the children of crossover and mutation each repeat, except those found in the genome cache
+    check(extractions + cacheStatistics.hits==populationSize + repeats*populationSize/2, "each birthed body is measured exactly once");
+    TestWeights last = stage.weights[0] + stage.weights[1]*(repeats - 1);
+    bool developed = true;
+    bool scored = true;
+    for(int i=0;i<populationSize;++i){
+        developed = developed && developsInto<HeadlessBackend>(genomes[i], developmentStages, bodies.bodies[i], maxCells);
+        scored = scored && fitness[i]==scoreCells(TestTargets{bodies.bodies[i].cellsNumber/1000.f}, plan.targets, last);
+    }
+    check(developed, "the returned bodies are what the returned genomes develop into");
+    check(scored, "the returned fitnesses are scored with the last repeat's weights");
+    return testResult();
+}
@@ -0,0 +1,73 @@
+///@file fitness-evaluation-test.cpp
+///@brief Checks the worker pool, and that evolve() scores each body with its own fitness whatever the number of threads sharing the work
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <atomic>
+#include <vector>
+
+const int populationSize = 24;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+
+void checkPool(int threads){
+    WorkerPool pool(threads);
+    const int count = 1000;
+    std::vector<std::atomic<int>> calls(count);
+    std::atomic<bool> threadsInRange(true);
+    pool.parallelFor(count, [&](int index, int thread){
+        ++calls[index];
+        if(thread<0 || thread>=pool.size()){
+            threadsInRange = false;
+        }
+    });
+    bool once = true;
+    for(int i=0;i<count;++i){
+        once = once && calls[i]==1;
+    }
+    std::atomic<int> submitted(0);
+    for(int i=0;i<10;++i){
+        pool.submit([&submitted](int){++submitted;});
+    }
+    pool.wait();
+    check(pool.size()==threads && once && threadsInRange && submitted==10, threads==1 ? "a pool of 1 thread runs every task once" : "a pool of 4 threads runs every task once");
+}
+
+///Runs a small plan with the given number of threads, and checks that each returned body is what its genome develops into and each fitness that body's
+void checkEvolve(int threads, int repeats, const char *name){
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    stage.weights[1] = {0.f, 0.f};
+    stage.repeats = repeats;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(4, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    settings.threads = threads;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    bool passed = true;
+    for(int i=0;i<populationSize;++i){
+        passed = passed && developsInto<HeadlessBackend>(genomes[i], developmentStages, bodies.bodies[i], maxCells);
+        passed = passed && fitness[i]==testFitness(&bodies.bodies[i], plan.targets, stage.weights[0]);
+    }
+    check(passed, name);
+}
+
+int main(){
+    checkPool(1);
+    checkPool(4);
+
+    //Without repeats only the initial population, scored on the pool, is returned
+    checkEvolve(1, 0, "the initial population scores its own bodies on 1 thread");
+    checkEvolve(4, 0, "the initial population scores its own bodies on 4 threads");
+    checkEvolve(4, 3, "evolve() on 4 threads returns matching genomes, bodies and fitnesses");
+    return testResult();
+}
@@ -0,0 +1,238 @@
+///@file generation-log-test.cpp
+///@brief Checks that a run's generation log reads back with its final population and lineage, ignores an incomplete tail, can be waited for up to a record, and continues across a resume into the file an uninterrupted run writes, but never past a gap, and that logs which can't be written are rejected before running
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+const int populationSize = 16;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+const std::string checkpointPath = "generation-log-test.ckpt";
+const std::string referenceLog = "generation-log-test-reference.evolog";
+const std::string resumedLog = "generation-log-test-resumed.evolog";
+
+struct Run{
+    std::vector<Genome_t> genomes;
+    std::vector<float> fitness;
+    TestBodies bodies;
+
+    Run() : fitness(populationSize), bodies(populationSize, maxCells){
+        for(int i=0;i<populationSize;++i){
+            genomes.push_back(testGenome(19, i));
+        }
+    }
+};
+
+///A seeded plan of two stages with two repeats each, whose substages fill the population in order: selection, crossover, then mutation
+struct TestPlan{
+    SelectionStage<TestWeights> stages[2];
+    SelectionPlan<TestWeights, TestTargets> plan{stages, 2, true, {0.5f}};
+
+    TestPlan(){
+        for(auto &stage : stages){
+            stage.weights[0] = {1.f, 0.f};
+            stage.weights[1] = {0.f, 0.25f};
+            stage.repeats = 2;
+            stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+            stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+            stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+        }
+        plan.seed = 0x106;
+    }
+};
+
+bool run(Run *run, const SelectionPlan<TestWeights, TestTargets> &plan, const EvolutionSettings &settings){
+    return evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(run->genomes.data(), populationSize, developmentStages, run->bodies.bodies.data(), run->fitness.data(), plan, testFitness, myGeneticDistance, settings);
+}
+
+std::string readFile(const std::string &path){
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &path, const std::string &bytes){
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+}
+
+///Whether generation's parents point into previous the way the substages of TestPlan breed
+bool consistentLineage(const GenerationView &previous, const GenerationView &generation){
+    bool consistent = true;
+    for(int k=0;consistent && k<populationSize;++k){
+        int first = generation.firstParents[k];
+        int second = generation.secondParents[k];
+        consistent = first>=0 && first<populationSize && second<populationSize;
+        if(k < populationSize/2){
+            consistent = consistent && second==-1 && !std::memcmp(&generation.genomes[k], &previous.genomes[first], sizeof(Genome_t));
+        } else if(k < 3*populationSize/4){
+            consistent = consistent && second>=0;
+        } else{
+            consistent = consistent && second==-1;
+        }
+    }
+    return consistent;
+}
+
+void checkLog(){
+    TestPlan test;
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    settings.logPath = referenceLog;
+    settings.logGenomes = true;
+    Run logged;
+    run(&logged, test.plan, settings);
+    GenerationLogReader reader;
+    bool read = reader.open(referenceLog) && reader.size()==5 && reader.completeBytes()==readFile(referenceLog).size();
+    bool passed = read && reader[0].stage==-1 && reader[0].repeat==-1;
+    for(size_t g=1;passed && g<reader.size();++g){
+        passed = reader[g].stage==int(g - 1)/2 && reader[g].repeat==int(g - 1)%2 && reader[g].populationSize==populationSize && reader[g].genomes;
+    }
+    check(passed, "a log holds the initial population and every repeat");
+    passed = read;
+    for(int k=0;passed && k<populationSize;++k){
+        const GenerationView &last = reader[reader.size() - 1];
+        passed = last.fitness[k]==logged.fitness[k] && !std::memcmp(&last.genomes[k], &logged.genomes[k], sizeof(Genome_t));
+        passed = passed && reader[0].firstParents[k]==-1 && reader[0].secondParents[k]==-1;
+    }
+    check(passed, "the last generation logged is the population returned");
+    passed = read;
+    for(size_t g=1;passed && g<reader.size();++g){
+        passed = consistentLineage(reader[g - 1], reader[g]);
+    }
+    check(passed, "parents point into the previous generation");
+    reader.close();
+
+    std::string bytes = readFile(referenceLog);
+    writeFile(resumedLog, bytes.substr(0, bytes.size() - 1));
+    bool truncated = reader.open(resumedLog) && reader.size()==4;
+    writeFile(resumedLog, bytes + "junk");
+    bool padded = reader.open(resumedLog) && reader.size()==5 && reader.completeBytes()==bytes.size();
+    writeFile(resumedLog, "EVOLOX" + bytes.substr(6));
+    check(truncated && padded && !reader.open(resumedLog) && !reader.open("missing-" + referenceLog), "incomplete blocks are ignored, foreign and missing files rejected");
+
+    settings.logGenomes = false;
+    Run unlogged;
+    run(&unlogged, test.plan, settings);
+    check(reader.open(referenceLog) && reader.size()==5 && !reader[4].genomes && reader[4].fitness[0]==unlogged.fitness[0], "genomes are only logged if asked for");
+
+    {
+        GenerationLogWriter writer(resumedLog, 4);
+        bool opened = writer.open(false);
+        for(int r=0;r<3;++r){
+            std::unique_ptr<GenerationRecord> record = writer.acquire();
+            record->stage = 0;
+            record->repeat = r;
+            record->fitness.assign(populationSize, r);
+            record->firstParents.assign(populationSize, -1);
+            record->secondParents.assign(populationSize, -1);
+            writer.submit(std::move(record));
+        }
+        writer.waitWritten(writer.submitted());
+        check(opened && reader.open(resumedLog) && reader.size()==3 && reader[2].repeat==2, "waiting for the records submitted finds them on disk");
+    }
+
+    //One steady-state generation is a repeat, whose children trace back to the population the repeat started from
+    test.plan.mode = STEADY_STATE;
+    test.plan.evaluationsPerRepeat = populationSize/2;
+    settings.logGenomes = true;
+    Run steadyState;
+    run(&steadyState, test.plan, settings);
+    passed = reader.open(referenceLog) && reader.size()==5;
+    for(int k=0;passed && k<populationSize;++k){
+        const GenerationView &last = reader[reader.size() - 1];
+        passed = last.fitness[k]==steadyState.fitness[k] && !std::memcmp(&last.genomes[k], &steadyState.genomes[k], sizeof(Genome_t));
+        passed = passed && last.firstParents[k]>=0 && last.firstParents[k]<populationSize;
+    }
+    check(passed, "a steady-state log ends with the population returned");
+}
+
+///Logs the whole plan, then the first stage with a checkpoint, and resumes the whole plan from it into the second log, which may already hold more than the first stage
+void checkResume(bool crashed, const char *name){
+    TestPlan test;
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    settings.logPath = referenceLog;
+    settings.logGenomes = true;
+    Run uninterrupted;
+    run(&uninterrupted, test.plan, settings);
+    test.plan.number = 1;
+    settings.logPath = resumedLog;
+    settings.checkpointPath = checkpointPath;
+    Run firstStage;
+    run(&firstStage, test.plan, settings);
+    if(crashed){
+        //As if the run had gone on past its checkpoint, and died writing a block
+        writeFile(resumedLog, readFile(referenceLog) + "junk");
+    }
+    test.plan.number = 2;
+    settings.checkpointPath.clear();
+    settings.resumeFrom = checkpointPath;
+    Run resumed;
+    run(&resumed, test.plan, settings);
+    check(resumed.fitness==uninterrupted.fitness && readFile(resumedLog)==readFile(referenceLog), name);
+}
+
+///Resumes from the checkpoint of the first stage with a log that is missing, then with one that stops short of the checkpoint
+void checkGaps(){
+    TestPlan test;
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    settings.logPath = referenceLog;
+    Run uninterrupted;
+    run(&uninterrupted, test.plan, settings);
+    test.plan.number = 1;
+    settings.logPath = resumedLog;
+    settings.checkpointPath = checkpointPath;
+    Run firstStage;
+    run(&firstStage, test.plan, settings);
+    std::string logged = readFile(resumedLog);
+    std::remove(resumedLog.c_str());
+    test.plan.number = 2;
+    settings.checkpointPath.clear();
+    settings.resumeFrom = checkpointPath;
+    Run resumed;
+    run(&resumed, test.plan, settings);
+    //The new log holds the last generation of the first stage, whose parents aren't known any more, then the second stage
+    std::string reference = readFile(referenceLog);
+    uint64_t block = GenerationLogReader::blockBytes(populationSize, false);
+    GenerationLogReader reader, referenceReader;
+    bool passed = reader.open(resumedLog) && referenceReader.open(referenceLog) && reader.size()==3 && reader[0].stage==0 && reader[0].repeat==1;
+    for(int k=0;passed && k<populationSize;++k){
+        passed = reader[0].fitness[k]==referenceReader[2].fitness[k] && reader[0].firstParents[k]==-1;
+    }
+    reader.close();
+    referenceReader.close();
+    check(passed && readFile(resumedLog).substr(64 + block)==reference.substr(64 + 3*block), "a missing log starts anew with the checkpointed generation");
+
+    std::string shortened = logged.substr(0, logged.size() - GenerationLogReader::blockBytes(populationSize, false));
+    writeFile(resumedLog, shortened);
+    Run rejected;
+    Run untouched;
+    //std::cerr is silenced while the errors are expected
+    std::streambuf *errors = std::cerr.rdbuf(nullptr);
+    passed = !run(&rejected, test.plan, settings) && readFile(resumedLog)==shortened;
+    settings.resumeFrom.clear();
+    settings.logPath = "missing-directory/" + resumedLog;
+    passed = passed && !run(&rejected, test.plan, settings);
+    std::cerr.rdbuf(errors);
+    passed = passed && rejected.fitness==untouched.fitness && !std::memcmp(rejected.genomes.data(), untouched.genomes.data(), populationSize*sizeof(Genome_t));
+    check(passed, "unopenable logs, or ones short of the checkpoint, are rejected");
+}
+
+int main(){
+    checkLog();
+    checkResume(false, "a resumed run continues the log of the uninterrupted one");
+    checkResume(true, "a resumed run drops what was logged after its checkpoint");
+    checkGaps();
+    std::remove(checkpointPath.c_str());
+    std::remove(referenceLog.c_str());
+    std::remove(resumedLog.c_str());
+    return testResult();
+}
@@ -0,0 +1,97 @@
+///@file genetic-distance-test.cpp
+///@brief Checks hammingGeneticDistance against a bit by bit count, the rows GeneticDistanceCache keeps and how many it allocates, and the mates selectMates picks
+
+#include <genetic-distance.hpp>
+#include <test-support.hpp>
+#include <algorithm>
+#include <vector>
+
+const int populationSize = 40;
+
+uint64_t bitByBitDistance(const Genome_t &first, const Genome_t &second){
+    uint64_t distance = 0;
+    for(size_t b=0;b<sizeof(Genome_t);++b){
+        for(int bit=0;bit<8;++bit){
+            distance += ((((const uint8_t*) &first)[b] ^ ((const uint8_t*) &second)[b]) >> bit) & 1;
+        }
+    }
+    return distance;
+}
+
+///@returns Whether the cached rows of individuals hold the distances to every genome
+bool rowsMatch(const GeneticDistanceCache &cache, const std::vector<Genome_t> &genomes, const std::vector<int> &individuals){
+    for(int i : individuals){
+        for(int m=0;m<populationSize;++m){
+            if(cache.row(i)[m]!=bitByBitDistance(genomes[i], genomes[m])){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(){
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(6, i));
+    }
+    bool same = hammingGeneticDistance(genomes[0], genomes[0])==0;
+    for(int i=1;i<populationSize;++i){
+        same = same && hammingGeneticDistance(genomes[0], genomes[i])==bitByBitDistance(genomes[0], genomes[i]);
+    }
+    check(same, "hammingGeneticDistance counts the differing bits");
+
+    WorkerPool pool(3);
+    GeneticDistanceCache cache(hammingGeneticDistance);
+    auto genomeAt = [&genomes](int i) -> const Genome_t&{return genomes[i];};
+    cache.reset(populationSize);
+    std::vector<int> first = {3, 7, 7, 12, 0};
+    cache.computeRows(first.data(), first.size(), genomeAt, &pool);
+    //Rows that overlap the ones above reuse their symmetric entries
+    std::vector<int> second = {12, 21, 39, 3};
+    cache.computeRows(second.data(), second.size(), genomeAt, &pool);
+    check(rowsMatch(cache, genomes, first) && rowsMatch(cache, genomes, second), "cached rows hold the distances to the whole population");
+    bool onlyAsked = cache.rowsAllocated()==6;
+    for(int i=0;i<populationSize;i+=2){
+        genomes[i] = testGenome(7, i);
+    }
+    cache.reset(populationSize);
+    cache.computeRows(second.data(), second.size(), genomeAt, &pool);
+    check(rowsMatch(cache, genomes, second), "reset() forgets the previous generation's rows");
+    onlyAsked = onlyAsked && cache.rowsAllocated()==6;
+    //A population this large would take 2GB as a full matrix
+    const int largePopulation = 16384;
+    std::vector<Genome_t> large(largePopulation, genomes[1]);
+    large[5] = genomes[2];
+    GeneticDistanceCache largeCache(hammingGeneticDistance);
+    largeCache.reset(largePopulation);
+    std::vector<int> largeParents = {5, 16383, 5};
+    largeCache.computeRows(largeParents.data(), largeParents.size(), [&large](int i) -> const Genome_t&{return large[i];}, &pool);
+    onlyAsked = onlyAsked && largeCache.rowsAllocated()==2 && largeCache.row(16383)[5]==bitByBitDistance(genomes[1], genomes[2]) && largeCache.row(5)[16383]==largeCache.row(16383)[5];
+    check(onlyAsked, "only the rows asked for are allocated, and reused after reset()");
+
+    std::vector<int> all(populationSize);
+    for(int i=0;i<populationSize;++i){
+        all[i] = i;
+    }
+    cache.computeRows(all.data(), all.size(), genomeAt, &pool);
+    std::vector<int> parents = {0, 5, 10, 15};
+    std::vector<int> mates(parents.size());
+    selectMates(populationSize, parents.data(), parents.size(), 1.f, cache, mates.data());
+    auto isParent = [&parents](int m){return std::find(parents.begin(), parents.end(), m)!=parents.end();};
+    bool farthest = true;
+    for(size_t l=0;l<parents.size();++l){
+        uint64_t largest = 0;
+        for(int m=0;m<populationSize;++m){
+            if(!isParent(m)){
+                largest = std::max(largest, cache.row(parents[l])[m]);
+            }
+        }
+        farthest = farthest && !isParent(mates[l]) && cache.row(parents[l])[mates[l]]==largest;
+    }
+    check(farthest, "a desired distance of 1 picks each parent's farthest non-parent");
+    mates.assign(populationSize, -1);
+    selectMates(populationSize, all.data(), all.size(), 0.5f, cache, mates.data());
+    check(mates==all, "parents mate with themselves when every individual is one");
+    return testResult();
+}
@@ -0,0 +1,199 @@
+///@file genetic-operators-test.cpp
+///@brief Checks that SelectionContext picks the same winners whether its tables are shared between substages or not and built ahead or not, forgets them when the fitnesses change, picks ranks as often as their weights say, and that mutation keeps genomes legal
+
+#include <development-backend.hpp>
+#include <genetic-operators.hpp>
+#include <test-support.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+const int populationSize = 50;
+const int picks = 200;
+const uint64_t seed = 0xC0FFEE;
+
+///Fills picks slots with substage, each pick drawing from the stream of its slot
+std::vector<int> select(SelectionContext *context, const SelectionSubstage &substage, uint32_t index){
+    std::vector<int> winners(picks);
+    for(int l=0;l<picks;++l){
+        RandomStream stream(seed, StreamId{0, 0, index, uint32_t(l)});
+        winners[l] = context->select(substage, &stream);
+    }
+    return winners;
+}
+
+///@returns How often substage picks each rank out of draws picks, rank 0 being the best individual
+std::vector<double> rankFrequencies(const SelectionSubstage &substage, int draws){
+    std::vector<float> fitness(populationSize);
+    for(int k=0;k<populationSize;++k){
+        fitness[k] = k;
+    }
+    SelectionContext context;
+    context.reset(populationSize, fitness.data(), true);
+    std::vector<double> frequencies(populationSize, 0.);
+    for(int l=0;l<draws;++l){
+        RandomStream stream(seed, StreamId{1, 0, 0, uint32_t(l)});
+        frequencies[populationSize - 1 - context.select(substage, &stream)] += 1./draws;
+    }
+    return frequencies;
+}
+
+///@returns Whether frequencies are within tolerance of expected(rank), and expected sums to 1
+template<class Expected>
+bool matches(const std::vector<double> &frequencies, Expected expected, double tolerance){
+    bool close = true;
+    double total = 0;
+    for(int r=0;r<populationSize;++r){
+        close = close && std::fabs(frequencies[r] - expected(r)) < tolerance;
+        total += expected(r);
+    }
+    return close && std::fabs(total - 1) < 1e-9;
+}
+
+///@returns testGenome with its field types, next types and directions in their legal ranges
+Genome_t legalGenome(uint32_t index){
+    Genome_t genome = testGenome(13, index);
+    for(size_t i=0;i<sizeof(genome.fieldTypes);++i){
+        genome.fieldTypes[i] %= fieldsNumber;
+        genome.nextTypes[i] %= stemCellsTypes;
+        genome.directions[i] = directions[genome.pulseThresholds[i]%8];
+    }
+    return genome;
+}
+
+///@returns Whether every categorical gene of genome is legal, and each other gene differs from original's by at most one bit
+bool legalMutation(const Genome_t &genome, const Genome_t &original){
+    bool legal = true;
+    for(size_t i=0;i<sizeof(genome.fieldTypes);++i){
+        legal = legal && genome.fieldTypes[i] < fieldsNumber && genome.nextTypes[i] < stemCellsTypes;
+        legal = legal && std::find(std::begin(directions), std::end(directions), genome.directions[i])!=std::end(directions);
+    }
+    auto oneBit = [&legal](const void *first, const void *second, size_t size, size_t geneSize){
+        for(size_t gene=0;gene<size;gene+=geneSize){
+            int flipped = 0;
+            for(size_t b=gene;b<gene+geneSize;++b){
+                flipped += __builtin_popcount(((const uint8_t*) first)[b] ^ ((const uint8_t*) second)[b]);
+            }
+            legal = legal && flipped <= 1;
+        }
+    };
+    oneBit(genome.pulseThresholds, original.pulseThresholds, sizeof(genome.pulseThresholds), 1);
+    oneBit(genome.permeabilities, original.permeabilities, sizeof(genome.permeabilities), 1);
+    oneBit(genome.amplitudes, original.amplitudes, sizeof(genome.amplitudes), 1);
+    oneBit(genome.changeThresholds, original.changeThresholds, sizeof(genome.changeThresholds), 1);
+    oneBit(genome.spawnThresholds, original.spawnThresholds, sizeof(genome.spawnThresholds), 1);
+    oneBit(genome.initialFieldsValues, original.initialFieldsValues, sizeof(genome.initialFieldsValues), 2);
+    return legal;
+}
+
+int main(){
+    std::vector<float> fitness(populationSize);
+    for(int k=0;k<populationSize;++k){
+        fitness[k] = std::sin(k*0.7f)*10;
+    }
+    //The last one has the same distribution as the first, whose table is reused
+    std::vector<SelectionSubstage> substages = {{SelectionSubstage::ROULETTE, 0.f, picks}, {SelectionSubstage::LINEAR, 1.5f, picks}, {SelectionSubstage::EXPONENTIAL, 0.9f, picks},
+                                                {SelectionSubstage::TOURNAMENT, 3, picks}, {SelectionSubstage::ROULETTE, 0.f, picks}};
+    for(bool maximize : {true, false}){
+        SelectionContext shared;
+        shared.reset(populationSize, fitness.data(), maximize);
+        bool same = true;
+        for(size_t s=0;s<substages.size();++s){
+            std::vector<int> winners = select(&shared, substages[s], s);
+            SelectionContext fresh;
+            fresh.reset(populationSize, fitness.data(), maximize);
+            same = same && select(&fresh, substages[s], s)==winners;
+        }
+        check(same, maximize ? "shared tables pick what fresh ones do when maximizing" : "shared tables pick what fresh ones do when minimizing");
+    }
+
+    SelectionContext prepared;
+    prepared.reset(populationSize, fitness.data(), true);
+    for(auto &substage : substages){
+        prepared.prepare(substage);
+    }
+    bool same = true;
+    for(size_t s=0;s<substages.size();++s){
+        SelectionContext lazy;
+        lazy.reset(populationSize, fitness.data(), true);
+        same = same && select(&prepared, substages[s], s)==select(&lazy, substages[s], s);
+    }
+    check(same, "tables built by prepare() pick what lazily built ones do");
+
+    SelectionContext context;
+    SelectionSubstage roulette(SelectionSubstage::ROULETTE, 0.f, picks);
+    SelectionSubstage linear(SelectionSubstage::LINEAR, 2.f, picks);
+    std::vector<float> onlyOne(populationSize, 0.f);
+    onlyOne[7] = 5.f;
+    context.reset(populationSize, onlyOne.data(), true);
+    std::vector<int> winners = select(&context, roulette, 0);
+    bool first = std::count(winners.begin(), winners.end(), 7)==picks;
+    //The worst ranked individual has no chance. All but one tie, so it's the last one by index
+    winners = select(&context, linear, 1);
+    bool worstNeverFirst = std::count(winners.begin(), winners.end(), populationSize - 1)==0;
+    std::vector<float> another(populationSize, 0.f);
+    another[31] = 5.f;
+    context.reset(populationSize, another.data(), true);
+    winners = select(&context, roulette, 0);
+    bool second = std::count(winners.begin(), winners.end(), 31)==picks;
+    winners = select(&context, linear, 1);
+    bool worstNeverSecond = std::count(winners.begin(), winners.end(), populationSize - 1)==0;
+    check(first && second && worstNeverFirst && worstNeverSecond, "reset() rebuilds the tables for new fitnesses");
+
+    const int draws = 200000;
+    bool weighted = true;
+    //Pressures beyond 2 were accepted by genetic-algorithm-- too
+    for(float selectionPressure : {0.5f, 1.5f, 3.f}){
+        std::vector<double> frequencies = rankFrequencies(SelectionSubstage(SelectionSubstage::LINEAR, selectionPressure, 1), draws);
+        weighted = weighted && matches(frequencies, [selectionPressure](int r){
+            //genetic-algorithm--'s P(r) = k1 - r*k2, normalized over the population
+            double k1 = double(selectionPressure)/populationSize;
+            double k2 = selectionPressure/(double(populationSize)*(populationSize - 1));
+            return (k1 - r*k2)/(selectionPressure/2.);
+        }, 0.003);
+    }
+    check(weighted, "linear ranking picks ranks as genetic-algorithm-- weighs them");
+    weighted = true;
+    for(float k1 : {0.1f, 0.5f}){
+        std::vector<double> frequencies = rankFrequencies(SelectionSubstage(SelectionSubstage::EXPONENTIAL, k1, 1), draws);
+        //A small k1 is a mild pressure
+        weighted = weighted && (k1 > 0.2f || frequencies[0] < 0.2) && matches(frequencies, [k1](int r){
+            return k1*std::pow(1. - k1, r)/(1. - std::pow(1. - k1, populationSize));
+        }, 0.003);
+    }
+    check(weighted, "exponential ranking picks rank r in proportion to k1*(1 - k1)^r");
+
+    bool legal = true;
+    bool changed = true;
+    bool develops = true;
+    for(uint32_t k=0;k<20;++k){
+        Genome_t original = legalGenome(k);
+        Genome_t genome = original;
+        RandomStream stream(seed, StreamId{2, 0, 0, k});
+        mutateGenomeFields(&genome, k < 10 ? 0.3f : 1.f, &stream);
+        legal = legal && legalMutation(genome, original);
+        //At probability 1 every categorical gene takes another value
+        for(size_t i=0;k>=10 && i<sizeof(genome.fieldTypes);++i){
+            changed = changed && genome.fieldTypes[i]!=original.fieldTypes[i] && genome.nextTypes[i]!=original.nextTypes[i] && genome.directions[i]!=original.directions[i];
+        }
+        changed = changed && std::memcmp(&genome, &original, sizeof(Genome_t));
+        CpuBackend backend;
+        backend.threads = 1;
+        backend.initialize();
+        std::vector<uint8_t> grid(bodyGridVolume);
+        backend.load(&genome);
+        backend.develop(4);
+        backend.birth(grid.data());
+        backend.release();
+        std::vector<Cell> cells(10*10*10);
+        Body body;
+        body.cells = cells.data();
+        isolateBody(&body, grid.data());
+        develops = develops && body.cellsNumber > 0 && developsInto<CpuBackend>(genome, 4, body, cells.size());
+    }
+    check(legal && changed, "mutation keeps genes legal and changes each as little as it can");
+    check(develops, "mutated genomes still develop");
+    return testResult();
+}
@@ -0,0 +1,80 @@
+///@file genome-cache-test.cpp
+///@brief Checks GenomeCache on its own, and that evolve() hands cached individuals back with fitnesses scored with the current weights
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <memory>
+#include <vector>
+
+const int populationSize = 24;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+
+using TestIndividual = Individual<SparseBodyStorage, NoFeatures>;
+
+IndividualHandle<SparseBodyStorage, NoFeatures> testIndividual(uint32_t index){
+    auto individual = std::make_shared<TestIndividual>();
+    individual->genome = testGenome(8, index);
+    return individual;
+}
+
+void checkCache(){
+    auto first = testIndividual(0);
+    auto second = testIndividual(1);
+    auto third = testIndividual(2);
+    size_t entryMemory = sizeof(GenomeCache<SparseBodyStorage, NoFeatures>::Entry) + sizeof(TestIndividual) + first->body.memoryFootprint();
+    GenomeCache<SparseBodyStorage, NoFeatures> cache(2*entryMemory);
+    bool missed = !cache.find(first->genome);
+    cache.insert(first, 1.f, 0);
+    auto *entry = cache.find(first->genome);
+    check(missed && entry && entry->individual==first && entry->fitness==1.f && entry->weightsVersion==0, "an inserted individual is found with its fitness");
+    cache.updateFitness(first->genome, 2.f, 1);
+    entry = cache.find(first->genome);
+    check(entry && entry->fitness==2.f && entry->weightsVersion==1, "updateFitness() replaces the remembered fitness");
+    cache.insert(second, 3.f, 1);
+    //first is now the least recently used
+    cache.find(first->genome);
+    cache.insert(third, 4.f, 1);
+    const GenomeCacheStatistics &statistics = cache.getStatistics();
+    check(cache.find(first->genome) && !cache.find(second->genome) && cache.find(third->genome) && statistics.evictions==1 && statistics.entries==2 && statistics.memoryUsed==2*entryMemory,
+          "the least recently used individual is evicted over budget");
+    GenomeCache<SparseBodyStorage, NoFeatures> disabled(0);
+    disabled.insert(first, 1.f, 0);
+    check(!disabled.find(first->genome) && disabled.getStatistics().entries==0, "a budget of 0 disables the cache");
+}
+
+int main(){
+    checkCache();
+
+    const int repeats = 3;
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    //Cached fitnesses go stale every repeat
+    stage.weights[1] = {0.f, 0.25f};
+    stage.repeats = repeats;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+    //Without mutations, every mutant is a genome that developed before
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.f, populationSize/4);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(9, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    GenomeCacheStatistics cacheStatistics;
+    settings.genomeCacheStatistics = &cacheStatistics;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    check(cacheStatistics.hits>=uint64_t(repeats*populationSize/4), "unmutated genomes are found in the cache");
+    TestWeights last = stage.weights[0] + stage.weights[1]*(repeats - 1);
+    bool passed = true;
+    for(int i=0;i<populationSize;++i){
+        passed = passed && developsInto<HeadlessBackend>(genomes[i], developmentStages, bodies.bodies[i], maxCells);
+        passed = passed && fitness[i]==testFitness(&bodies.bodies[i], plan.targets, last);
+    }
+    check(passed, "cached individuals come back with the last repeat's fitness");
+    return testResult();
+}
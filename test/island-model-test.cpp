@@ -0,0 +1,239 @@
+///@file island-model-test.cpp
+///@brief Checks the migration hook of evolve(), which islands each topology connects, and that evolveIslands() returns populations scored right, the same on every run, or returns false if an island fails, each island making its own backend, that islands can't checkpoint or resume, and that each one writes its own log
+
+#include <island-model.hpp>
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const int populationSize = 12;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+const int repeats = 4;
+
+///@returns The fitness genome gets with weights, developed on a fresh backend
+float fitnessOf(Genome_t genome, const TestTargets &targets, const TestWeights &weights){
+    HeadlessBackend backend;
+    backend.initialize();
+    std::vector<uint8_t> grid(bodyGridVolume);
+    backend.load(&genome);
+    backend.develop(developmentStages);
+    backend.birth(grid.data());
+    backend.release();
+    std::vector<Cell> cells(maxCells);
+    Body body;
+    body.cells = cells.data();
+    isolateBody(&body, grid.data());
+    return testFitness(&body, targets, weights);
+}
+
+///A headless backend that only starts once it knows which island it develops for, as a GPU backend would need to pick its device
+struct IslandBackend : HeadlessBackend{
+    int island = -1;
+
+    bool initialize(){
+        return island>=0 && HeadlessBackend::initialize();
+    }
+};
+
+///Makes each island's backend, or one that can't start for the island failing
+std::function<IslandBackend(int)> islandBackends(int failing = -1){
+    return [failing](int island){
+        IslandBackend backend;
+        backend.island = island==failing ? -1 : island;
+        return backend;
+    };
+}
+
+struct TestPlan{
+    SelectionStage<TestWeights> stage;
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+
+    explicit TestPlan(uint64_t seed){
+        stage.weights[0] = {1.f, 0.f};
+        stage.weights[1] = {0.f, 0.25f};
+        stage.repeats = repeats;
+        stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+        stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+        stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+        plan.seed = seed;
+    }
+    TestWeights lastWeights() const{
+        return stage.weights[0] + stage.weights[1]*(repeats - 1);
+    }
+};
+
+void checkTopologies(){
+    check(islandSources(RING, 0, 4)==std::vector<int>{3} && islandSources(RING, 2, 4)==std::vector<int>{1}, "a ring connects each island to the previous one");
+    check(islandSources(FULLY_CONNECTED, 1, 4)==std::vector<int>({0, 2, 3}), "a fully connected island receives from every other");
+    check(islandSources(STAR, 0, 4)==std::vector<int>({1, 2, 3}) && islandSources(STAR, 3, 4)==std::vector<int>{0}, "a star connects its center with every other island");
+    check(islandSources(RING, 0, 1).empty(), "a single island receives from none");
+}
+
+///Runs a plan whose last migration brings in a known genome
+void checkMigrationHook(){
+    TestPlan test(21);
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(22, i));
+    }
+    Genome_t immigrant = testGenome(23, 0);
+    std::vector<int> migratedAfter;
+    bool ranked = true;
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    settings.migrationInterval = 2;
+    settings.migration = [&](Migration &migration){
+        migratedAfter.push_back(migration.repeat);
+        ranked = ranked && migration.ranked.size()==size_t(populationSize) && std::is_sorted(migration.fitness.rbegin(), migration.fitness.rend());
+        if(migration.repeat==repeats - 1){
+            migration.immigrants.push_back(immigrant);
+        }
+    };
+    std::vector<float> fitness(populationSize);
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, nullptr, fitness.data(), test.plan, testFitness, myGeneticDistance, settings);
+    check(migratedAfter==std::vector<int>({1, 3}) && ranked, "migration is called every interval with the population ranked");
+    int arrived = -1;
+    for(int k=0;k<populationSize;++k){
+        if(!std::memcmp(&genomes[k], &immigrant, sizeof(Genome_t))){
+            arrived = k;
+        }
+    }
+    check(arrived>=0 && fitness[arrived]==fitnessOf(immigrant, test.plan.targets, test.lastWeights()), "immigrants join the population, scored with the last weights");
+}
+
+///Runs 3 islands on a ring, and @returns their final genomes and fitnesses
+std::vector<float> runRing(std::vector<Genome_t> *genomes, bool *consistent){
+    const int islandsNumber = 3;
+    std::vector<TestPlan> tests;
+    std::vector<SelectionPlan<TestWeights, TestTargets>> plans;
+    for(int i=0;i<islandsNumber;++i){
+        tests.emplace_back(30 + i);
+    }
+    for(auto &test : tests){
+        test.plan.stages = &test.stage;
+        plans.push_back(test.plan);
+    }
+    genomes->clear();
+    for(int i=0;i<islandsNumber*populationSize;++i){
+        genomes->push_back(testGenome(24, i));
+    }
+    std::vector<float> fitness(islandsNumber*populationSize);
+    IslandSettings islands;
+    islands.islands = islandsNumber;
+    islands.migrationInterval = 2;
+    islands.migrants = 2;
+    islands.pinIslands = false;
+    EvolutionSettings settings;
+    settings.threads = 1;
+    settings.printProgress = false;
+    *consistent = evolveIslands<TestWeights, TestTargets, SparseBodyStorage, IslandBackend>(genomes->data(), populationSize, developmentStages, fitness.data(), plans.data(), testFitness, islands, settings, islandBackends());
+    for(int k=0;k<islandsNumber*populationSize;++k){
+        *consistent = *consistent && fitness[k]==fitnessOf((*genomes)[k], tests[0].plan.targets, tests[0].lastWeights());
+    }
+    return fitness;
+}
+
+///Runs 3 islands on a ring, the second one with a plan that can't run, then the third one without a backend, which mustn't change anything
+void checkFailingIsland(){
+    const int islandsNumber = 3;
+    std::vector<TestPlan> tests;
+    std::vector<SelectionPlan<TestWeights, TestTargets>> plans;
+    for(int i=0;i<islandsNumber;++i){
+        tests.emplace_back(40 + i);
+    }
+    tests[1].stage.substages.back().individuals = 1;
+    for(auto &test : tests){
+        test.plan.stages = &test.stage;
+        plans.push_back(test.plan);
+    }
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<islandsNumber*populationSize;++i){
+        genomes.push_back(testGenome(25, i));
+    }
+    std::vector<Genome_t> initial = genomes;
+    std::vector<float> fitness(islandsNumber*populationSize, -1.f);
+    IslandSettings islands;
+    islands.islands = islandsNumber;
+    islands.migrationInterval = 2;
+    islands.pinIslands = false;
+    EvolutionSettings settings;
+    settings.threads = 1;
+    settings.printProgress = false;
+    //std::cerr is silenced while the errors are expected, in the islands too
+    std::streambuf *errors = std::cerr.rdbuf(nullptr);
+    bool ran = evolveIslands<TestWeights, TestTargets, SparseBodyStorage, IslandBackend>(genomes.data(), populationSize, developmentStages, fitness.data(), plans.data(), testFitness, islands, settings, islandBackends());
+    tests[1].stage.substages.back().individuals = populationSize/4;
+    ran = ran || evolveIslands<TestWeights, TestTargets, SparseBodyStorage, IslandBackend>(genomes.data(), populationSize, developmentStages, fitness.data(), plans.data(), testFitness, islands, settings, islandBackends(2));
+    std::cerr.rdbuf(errors);
+    bool untouched = fitness==std::vector<float>(islandsNumber*populationSize, -1.f) && !std::memcmp(genomes.data(), initial.data(), genomes.size()*sizeof(Genome_t));
+    check(!ran && untouched, "a failing island makes evolveIslands() return false");
+    bool started = evolveIslands<TestWeights, TestTargets, SparseBodyStorage, IslandBackend>(genomes.data(), populationSize, developmentStages, fitness.data(), plans.data(), testFitness, islands, settings, islandBackends());
+    check(started, "each island makes its backend after it is forked");
+}
+
+///Runs 2 islands logging to one path, after checking that islands which would checkpoint or resume are rejected
+void checkIslandFiles(){
+    const int islandsNumber = 2;
+    const std::string logPath = "island-model-test.evolog";
+    std::vector<TestPlan> tests;
+    std::vector<SelectionPlan<TestWeights, TestTargets>> plans;
+    for(int i=0;i<islandsNumber;++i){
+        tests.emplace_back(50 + i);
+    }
+    for(auto &test : tests){
+        test.plan.stages = &test.stage;
+        plans.push_back(test.plan);
+    }
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<islandsNumber*populationSize;++i){
+        genomes.push_back(testGenome(26, i));
+    }
+    std::vector<float> fitness(islandsNumber*populationSize, -1.f);
+    IslandSettings islands;
+    islands.islands = islandsNumber;
+    islands.migrationInterval = 2;
+    islands.pinIslands = false;
+    EvolutionSettings settings;
+    settings.threads = 1;
+    settings.printProgress = false;
+    std::streambuf *errors = std::cerr.rdbuf(nullptr);
+    settings.checkpointPath = "island-model-test.ckpt";
+    bool ran = evolveIslands<TestWeights, TestTargets, SparseBodyStorage, IslandBackend>(genomes.data(), populationSize, developmentStages, fitness.data(), plans.data(), testFitness, islands, settings, islandBackends());
+    settings.checkpointPath.clear();
+    settings.resumeFrom = "island-model-test.ckpt";
+    ran = ran || evolveIslands<TestWeights, TestTargets, SparseBodyStorage, IslandBackend>(genomes.data(), populationSize, developmentStages, fitness.data(), plans.data(), testFitness, islands, settings, islandBackends());
+    std::cerr.rdbuf(errors);
+    settings.resumeFrom.clear();
+    check(!ran && fitness==std::vector<float>(islandsNumber*populationSize, -1.f), "islands can't be checkpointed or resumed");
+    settings.logPath = logPath;
+    bool logged = evolveIslands<TestWeights, TestTargets, SparseBodyStorage, IslandBackend>(genomes.data(), populationSize, developmentStages, fitness.data(), plans.data(), testFitness, islands, settings, islandBackends());
+    for(int i=0;i<islandsNumber;++i){
+        GenerationLogReader reader;
+        logged = logged && reader.open(islandLogPath(logPath, i)) && reader.size()==repeats + 1;
+        for(int k=0;logged && k<populationSize;++k){
+            logged = reader[reader.size() - 1].fitness[k]==fitness[i*populationSize + k];
+        }
+        std::remove(islandLogPath(logPath, i).c_str());
+    }
+    check(logged, "each island writes its own log");
+}
+
+int main(){
+    checkTopologies();
+    checkMigrationHook();
+    std::vector<Genome_t> first, second;
+    bool consistent;
+    std::vector<float> fitness = runRing(&first, &consistent);
+    check(consistent, "islands return genomes with matching fitnesses");
+    check(runRing(&second, &consistent)==fitness && !std::memcmp(first.data(), second.data(), first.size()*sizeof(Genome_t)), "islands evolve the same way on every run");
+    checkFailingIsland();
+    checkIslandFiles();
+    return testResult();
+}
@@ -0,0 +1,105 @@
+///@file pipeline-test.cpp
+///@brief Checks DevelopmentPipeline on the headless backend: what it develops doesn't depend on its depth, and a deeper pipeline overlaps development with processing
+/*! Also checks that evolve(), whatever its development depth, returns genomes, bodies and fitnesses that belong together.
+ */
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+const int genomesNumber = 12;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+
+///@returns A digest of the grid each genome was birthed into, or 0 for the genomes finish() didn't get exactly once
+std::vector<uint64_t> developAll(int depth, int threads){
+    HeadlessBackend backend;
+    backend.initialize();
+    WorkerPool pool(threads);
+    std::vector<Genome_t> genomes;
+    for(int k=0;k<genomesNumber;++k){
+        genomes.push_back(testGenome(1, k));
+    }
+    std::vector<uint64_t> digests(genomesNumber);
+    std::vector<std::atomic<int>> finished(genomesNumber);
+    DevelopmentPipeline<HeadlessBackend> pipeline(&backend, &pool, depth);
+    pipeline.develop(genomesNumber, developmentStages, [&](int k){return &genomes[k];}, [&](int k, uint8_t *grid, int){
+        uint64_t digest = 14695981039346656037ull;
+        for(uint32_t i=0;i<bodyGridVolume;++i){
+            digest = (digest ^ grid[i]) * 1099511628211ull;
+        }
+        digests[k] = digest;
+        ++finished[k];
+    });
+    for(int k=0;k<genomesNumber;++k){
+        if(finished[k]!=1){
+            digests[k] = 0;
+        }
+    }
+    return digests;
+}
+
+///@returns How long the pipeline takes when developing and processing each genome both take latency
+double secondsWithLatency(int depth, std::chrono::milliseconds latency){
+    HeadlessBackend backend;
+    backend.initialize();
+    backend.latency = latency;
+    Genome_t genome = testGenome(2, 0);
+    WorkerPool pool(1);
+    DevelopmentPipeline<HeadlessBackend> pipeline(&backend, &pool, depth);
+    auto start = std::chrono::steady_clock::now();
+    pipeline.develop(genomesNumber, developmentStages, [&](int){return &genome;}, [&](int, uint8_t*, int){
+        std::this_thread::sleep_for(latency);
+    });
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+///Runs a small plan, and checks that each returned body is what its genome develops into and each fitness that body's
+void checkEvolve(int depth, const char *name){
+    const int populationSize = 16;
+    SelectionStage<TestWeights> stage;
+    stage.weights[0] = {1.f, 0.f};
+    stage.weights[1] = {0.f, 0.f};
+    stage.repeats = 3;
+    stage.substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+    stage.substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+    stage.substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+    SelectionPlan<TestWeights, TestTargets> plan{&stage, 1, true, {0.5f}};
+    std::vector<Genome_t> genomes;
+    for(int i=0;i<populationSize;++i){
+        genomes.push_back(testGenome(3, i));
+    }
+    std::vector<float> fitness(populationSize);
+    TestBodies bodies(populationSize, maxCells);
+    EvolutionSettings settings;
+    settings.developmentDepth = depth;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(genomes.data(), populationSize, developmentStages, bodies.bodies.data(), fitness.data(), plan, testFitness, myGeneticDistance, settings);
+    bool passed = true;
+    for(int i=0;i<populationSize;++i){
+        passed = passed && developsInto<HeadlessBackend>(genomes[i], developmentStages, bodies.bodies[i], maxCells);
+        passed = passed && fitness[i]==testFitness(&bodies.bodies[i], plan.targets, stage.weights[0]);
+    }
+    check(passed, name);
+}
+
+int main(){
+    std::vector<uint64_t> serial = developAll(1, 1);
+    check(std::count(serial.begin(), serial.end(), 0)==0, "grids are processed once each");
+    check(developAll(4, 1)==serial, "a deeper pipeline develops the same grids");
+    check(developAll(4, 3)==serial, "more processing threads develop the same grids");
+
+    std::chrono::milliseconds latency(10);
+    double alternating = secondsWithLatency(1, latency);
+    double overlapped = secondsWithLatency(3, latency);
+    std::printf("%d developments and processings of %lldms each: %.3fs at depth 1, %.3fs at depth 3\n", genomesNumber, (long long) latency.count(), alternating, overlapped);
+    check(overlapped < 0.75*alternating, "a deeper pipeline overlaps development with processing");
+
+    checkEvolve(1, "evolve() returns matching genomes, bodies and fitnesses at depth 1");
+    checkEvolve(3, "evolve() returns matching genomes, bodies and fitnesses at depth 3");
+    return testResult();
+}
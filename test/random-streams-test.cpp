@@ -0,0 +1,152 @@
+///@file random-streams-test.cpp
+///@brief Checks Philox4x32 against its published answers, and that a seeded run only depends on its seed and initial genomes
+/*! Seeded runs have to return the same genomes, bodies and fitnesses whatever the number of threads, the development depth and the genome cache,
+ *  and a run resumed from a checkpoint has to end like the run that wasn't interrupted.
+ */
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const int populationSize = 16;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+const std::string checkpointPath = "random-streams-test.ckpt";
+
+bool philoxAnswers(uint32_t counter0, uint32_t counter1, uint32_t counter2, uint32_t counter3, uint64_t seed, const uint32_t expected[4]){
+    uint32_t counter[4] = {counter0, counter1, counter2, counter3};
+    Philox4x32::generate(counter, seed);
+    return counter[0]==expected[0] && counter[1]==expected[1] && counter[2]==expected[2] && counter[3]==expected[3];
+}
+
+void checkStreams(){
+    //From the known answer tests of Random123
+    const uint32_t zeros[4] = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+    const uint32_t ones[4] = {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd};
+    const uint32_t pi[4] = {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1};
+    check(philoxAnswers(0, 0, 0, 0, 0, zeros) && philoxAnswers(~0u, ~0u, ~0u, ~0u, ~0ull, ones) && philoxAnswers(0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0x299f31d0a4093822ull, pi),
+          "Philox4x32-10 gives the published answers");
+    RandomStream first(42, StreamId{1, 2, 3, 4});
+    RandomStream again(42, StreamId{1, 2, 3, 4});
+    RandomStream otherSlot(42, StreamId{1, 2, 3, 5});
+    RandomStream otherSeed(43, StreamId{1, 2, 3, 4});
+    bool same = true;
+    bool different = false;
+    for(int i=0;i<100;++i){
+        uint32_t number = first.next();
+        same = same && number==again.next();
+        different = different || number!=otherSlot.next() || number!=otherSeed.next();
+    }
+    check(same && different, "streams only depend on their seed and id");
+    bool inRange = true;
+    for(int i=0;i<10000;++i){
+        double uniform = first.uniform();
+        inRange = inRange && uniform>=0 && uniform<1 && first.below(7)<7;
+    }
+    check(inRange, "uniform() and below() stay in range");
+}
+
+struct Run{
+    std::vector<Genome_t> genomes;
+    std::vector<float> fitness;
+    TestBodies bodies;
+
+    Run() : fitness(populationSize), bodies(populationSize, maxCells){
+        for(int i=0;i<populationSize;++i){
+            genomes.push_back(testGenome(13, i));
+        }
+    }
+    bool operator==(const Run &other) const{
+        bool same = fitness==other.fitness;
+        for(int k=0;same && k<populationSize;++k){
+            same = !std::memcmp(&genomes[k], &other.genomes[k], sizeof(Genome_t)) && sameBody(bodies.bodies[k], other.bodies.bodies[k]);
+        }
+        return same;
+    }
+};
+
+///A plan of two stages with two repeats each, using every kind of substage
+struct TestPlan{
+    SelectionStage<TestWeights> stages[2];
+    SelectionPlan<TestWeights, TestTargets> plan{stages, 2, true, {0.5f}};
+
+    TestPlan(){
+        stages[0].weights[0] = {1.f, 0.f};
+        stages[0].weights[1] = {0.f, 0.25f};
+        stages[0].repeats = 2;
+        stages[0].substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/4);
+        stages[0].substages.emplace_back(SelectionSubstage::ROULETTE, 0.f, populationSize/4);
+        stages[0].substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+        stages[0].substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+        stages[1].weights[0] = {2.f, 0.f};
+        stages[1].weights[1] = {0.f, 0.f};
+        stages[1].repeats = 2;
+        stages[1].substages.emplace_back(SelectionSubstage::LINEAR, 1.5f, populationSize/4);
+        stages[1].substages.emplace_back(SelectionSubstage::EXPONENTIAL, 0.5f, populationSize/4);
+        stages[1].substages.emplace_back(SelectionSubstage::UNIFORM_CO, 0.8f, populationSize/4);
+        stages[1].substages.emplace_back(SelectionSubstage::MUTATE, 0.1f, populationSize/4);
+        plan.seed = 0x5eed;
+    }
+};
+
+void run(Run *run, const SelectionPlan<TestWeights, TestTargets> &plan, const EvolutionSettings &settings){
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(run->genomes.data(), populationSize, developmentStages, run->bodies.bodies.data(), run->fitness.data(), plan, testFitness, myGeneticDistance, settings);
+}
+
+///Runs the first stage with a checkpoint, and resumes the whole plan from it
+void checkResume(const Run &uninterrupted, bool checkpointBodies, const char *name){
+    TestPlan test;
+    test.plan.number = 1;
+    EvolutionSettings settings;
+    settings.checkpointPath = checkpointPath;
+    settings.checkpointBodies = checkpointBodies;
+    Run firstStage;
+    run(&firstStage, test.plan, settings);
+    test.plan.number = 2;
+    settings.checkpointPath.clear();
+    settings.resumeFrom = checkpointPath;
+    Run resumed;
+    run(&resumed, test.plan, settings);
+    check(resumed==uninterrupted, name);
+}
+
+int main(){
+    checkStreams();
+
+    TestPlan test;
+    EvolutionSettings settings;
+    settings.threads = 1;
+    settings.developmentDepth = 1;
+    Run serial;
+    run(&serial, test.plan, settings);
+    bool consistent = true;
+    for(int i=0;i<populationSize;++i){
+        consistent = consistent && developsInto<HeadlessBackend>(serial.genomes[i], developmentStages, serial.bodies.bodies[i], maxCells);
+        consistent = consistent && serial.fitness[i]==testFitness(&serial.bodies.bodies[i], test.plan.targets, test.stages[1].weights[0]);
+    }
+    check(consistent, "a seeded run returns matching genomes, bodies and fitnesses");
+    Run again;
+    run(&again, test.plan, settings);
+    check(again==serial, "a seeded run is reproduced by its seed");
+    settings.threads = 4;
+    settings.developmentDepth = 0;
+    Run parallel;
+    run(&parallel, test.plan, settings);
+    check(parallel==serial, "a seeded run doesn't depend on threads and depth");
+    settings.genomeCacheBudget = 0;
+    Run uncached;
+    run(&uncached, test.plan, settings);
+    check(uncached==serial, "a seeded run doesn't depend on the genome cache");
+    test.plan.seed = 0x5eee;
+    Run reseeded;
+    run(&reseeded, test.plan, settings);
+    check(!(reseeded==serial), "another seed gives another run");
+
+    checkResume(serial, false, "a resumed run ends like the uninterrupted one");
+    checkResume(serial, true, "a run resumed with bodies ends like the uninterrupted one");
+    std::remove(checkpointPath.c_str());
+    return testResult();
+}
@@ -0,0 +1,91 @@
+///@file static-plan-test.cpp
+///@brief Checks that a StaticPlan describes the SelectionPlan it converts to, and runs exactly like it in both modes
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <vector>
+
+const int populationSize = 16;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+
+using FirstStage = StaticStage<TestWeights, Tournament<4>, Roulette<2>, LinearRanking<2>, TwoPointsCrossover<4>, Mutation<4>>;
+using SecondStage = StaticStage<TestWeights, ExponentialRanking<8>, UniformCrossover<4>, Mutation<4>>;
+using TestStaticPlan = StaticPlan<TestWeights, TestTargets, populationSize, FirstStage, SecondStage>;
+
+static_assert(FirstStage::individuals==populationSize && SecondStage::individuals==populationSize, "Substages add up to the population size");
+static_assert(FirstStage::firstSlot(0)==0 && FirstStage::firstSlot(3)==8 && FirstStage::firstSlot(4)==12, "Substages fill consecutive slots");
+
+TestTargets extractCells(Body *body){
+    return TestTargets{body->cellsNumber/1000.f};
+}
+
+float scoreCells(const TestTargets &features, const TestTargets &targets, const TestWeights &weights){
+    return weights.cellsFactor * std::exp(-std::fabs(features.cells - targets.cells)) + weights.offset;
+}
+
+TestStaticPlan testPlan(){
+    FirstStage first({1.f, 0.f}, {0.f, 0.25f}, 2, {3}, {}, {1.5f}, {0.2f}, {0.05f});
+    SecondStage second({2.f, 0.f}, {0.f, 0.f}, 2, {0.9f}, {0.8f}, {0.1f});
+    TestStaticPlan plan(true, {0.5f}, first, second);
+    plan.seed = 0x57a71c;
+    return plan;
+}
+
+struct Run{
+    std::vector<Genome_t> genomes;
+    std::vector<float> fitness;
+    TestBodies bodies;
+
+    Run() : fitness(populationSize), bodies(populationSize, maxCells){
+        for(int i=0;i<populationSize;++i){
+            genomes.push_back(testGenome(18, i));
+        }
+    }
+    bool operator==(const Run &other) const{
+        bool same = fitness==other.fitness;
+        for(int k=0;same && k<populationSize;++k){
+            same = !std::memcmp(&genomes[k], &other.genomes[k], sizeof(Genome_t)) && sameBody(bodies.bodies[k], other.bodies.bodies[k]);
+        }
+        return same;
+    }
+};
+
+///Runs plan both as it is and as a SelectionPlan, on the same Evolver
+void checkSameRuns(const TestStaticPlan &plan, bool features, const char *name){
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    settings.developmentDepth = 1;
+    Evolver<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend> evolver(settings);
+    std::vector<SelectionStage<TestWeights>> stages;
+    SelectionPlan<TestWeights, TestTargets> runtime = plan.toSelectionPlan(&stages);
+    Run typed, converted;
+    if(features){
+        evolver.run(typed.genomes.data(), developmentStages, typed.bodies.bodies.data(), typed.fitness.data(), plan, extractCells, scoreCells);
+        evolver.run(converted.genomes.data(), populationSize, developmentStages, converted.bodies.bodies.data(), converted.fitness.data(), runtime, extractCells, scoreCells);
+    } else{
+        evolver.run(typed.genomes.data(), developmentStages, typed.bodies.bodies.data(), typed.fitness.data(), plan, testFitness);
+        evolver.run(converted.genomes.data(), populationSize, developmentStages, converted.bodies.bodies.data(), converted.fitness.data(), runtime, testFitness);
+    }
+    check(typed==converted, name);
+}
+
+int main(){
+    TestStaticPlan plan = testPlan();
+    std::vector<SelectionStage<TestWeights>> stages;
+    SelectionPlan<TestWeights, TestTargets> runtime = plan.toSelectionPlan(&stages);
+    bool described = runtime.number==2 && runtime.seed==plan.seed && runtime.maximizeFitness && runtime.targets.cells==0.5f;
+    described = described && stages[0].repeats==2 && stages[0].weights[1].offset==0.25f && stages[0].substages.size()==5 && stages[1].substages.size()==3;
+    described = described && stages[0].substages[0].type==SelectionSubstage::TOURNAMENT && stages[0].substages[0].param.tournamentSize==3 && stages[0].substages[0].individuals==4;
+    described = described && stages[0].substages[3].type==SelectionSubstage::TWO_POINTS_CO && stages[0].substages[3].param.desiredGeneticDistance==0.2f;
+    described = described && stages[1].substages[0].type==SelectionSubstage::EXPONENTIAL && stages[1].substages[0].param.k1==0.9f && stages[1].substages[2].param.mutationProbability==0.1f;
+    check(described, "toSelectionPlan() describes the same stages and substages");
+
+    checkSameRuns(plan, false, "a static plan runs like its SelectionPlan");
+    checkSameRuns(plan, true, "a static plan measuring features runs like its SelectionPlan");
+    plan.mode = STEADY_STATE;
+    plan.evaluationsPerRepeat = 6;
+    checkSameRuns(plan, false, "a steady-state static plan runs like its SelectionPlan");
+    return testResult();
+}
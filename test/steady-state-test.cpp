@@ -0,0 +1,260 @@
+///@file steady-state-test.cpp
+///@brief Checks the steady-state mode: what it returns belongs together, seeded runs don't depend on the number of threads at any depth while deeper ones overlap development with scoring and hand children in during mate searches, plans with nothing to breed are rejected, and resumed runs end and log like uninterrupted ones
+
+#include <evolution.hpp>
+#include <test-support.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const int populationSize = 16;
+const int developmentStages = 4;
+//HeadlessBackend bodies are boxes at most 2*(stages + 1) voxels wide
+const uint64_t maxCells = 10*10*10;
+const std::string checkpointPath = "steady-state-test.ckpt";
+const std::string referenceLog = "steady-state-test-reference.evolog";
+const std::string resumedLog = "steady-state-test-resumed.evolog";
+
+struct Run{
+    std::vector<Genome_t> genomes;
+    std::vector<float> fitness;
+    TestBodies bodies;
+
+    Run() : fitness(populationSize), bodies(populationSize, maxCells){
+        for(int i=0;i<populationSize;++i){
+            genomes.push_back(testGenome(17, i));
+        }
+    }
+    bool operator==(const Run &other) const{
+        bool same = fitness==other.fitness;
+        for(int k=0;same && k<populationSize;++k){
+            same = !std::memcmp(&genomes[k], &other.genomes[k], sizeof(Genome_t)) && sameBody(bodies.bodies[k], other.bodies.bodies[k]);
+        }
+        return same;
+    }
+};
+
+///A steady-state plan of two stages, the first one changing its weights every repeat
+struct TestPlan{
+    SelectionStage<TestWeights> stages[2];
+    SelectionPlan<TestWeights, TestTargets> plan{stages, 2, true, {0.5f}};
+
+    TestPlan(){
+        stages[0].weights[0] = {1.f, 0.f};
+        stages[0].weights[1] = {0.f, 0.25f};
+        stages[0].repeats = 3;
+        stages[0].substages.emplace_back(SelectionSubstage::TOURNAMENT, 3, populationSize/2);
+        stages[0].substages.emplace_back(SelectionSubstage::TWO_POINTS_CO, 0.2f, populationSize/4);
+        stages[0].substages.emplace_back(SelectionSubstage::MUTATE, 0.05f, populationSize/4);
+        stages[1].weights[0] = {2.f, 0.f};
+        stages[1].weights[1] = {0.f, 0.f};
+        stages[1].repeats = 2;
+        stages[1].substages.emplace_back(SelectionSubstage::LINEAR, 1.5f, populationSize/2);
+        stages[1].substages.emplace_back(SelectionSubstage::UNIFORM_CO, 0.8f, populationSize/4);
+        stages[1].substages.emplace_back(SelectionSubstage::MUTATE, 0.1f, populationSize/4);
+        plan.seed = 0x57ead;
+        plan.mode = STEADY_STATE;
+        plan.evaluationsPerRepeat = 6;
+    }
+};
+
+void run(Run *run, const SelectionPlan<TestWeights, TestTargets> &plan, const EvolutionSettings &settings){
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(run->genomes.data(), populationSize, developmentStages, run->bodies.bodies.data(), run->fitness.data(), plan, testFitness, myGeneticDistance, settings);
+}
+
+std::mutex measuring;
+int births = 0;
+int measured = 0;
+int mostMeasured = 0;
+
+///Measures the cells of a body slowly, keeping track of how many children bred in steady state are measured at once. It's only called on birth, rescoring goes through scoreCells
+TestTargets slowlyExtractCells(Body *body){
+    bool child;
+    {
+        std::lock_guard<std::mutex> lock(measuring);
+        //The initial population is developed first, all of it
+        child = births++ >= populationSize;
+        measured += child;
+        mostMeasured = std::max(mostMeasured, measured);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::lock_guard<std::mutex> lock(measuring);
+    measured -= child;
+    return TestTargets{body->cellsNumber/1000.f};
+}
+
+float scoreCells(const TestTargets &features, const TestTargets &targets, const TestWeights &weights){
+    return weights.cellsFactor * std::exp(-std::fabs(features.cells - targets.cells)) + weights.offset;
+}
+
+///@returns How many children a seeded run of plan, measuring bodies with slowlyExtractCells, scored at once at most after the initial population
+int mostScoredAtDepth(const SelectionPlan<TestWeights, TestTargets> &plan, EvolutionSettings settings, int depth, double *seconds){
+    settings.developmentDepth = depth;
+    births = 0;
+    mostMeasured = 0;
+    Run measuredRun;
+    auto start = std::chrono::steady_clock::now();
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(measuredRun.genomes.data(), populationSize, developmentStages, measuredRun.bodies.bodies.data(), measuredRun.fitness.data(), plan, slowlyExtractCells, scoreCells, myGeneticDistance, settings);
+    *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return mostMeasured;
+}
+
+//Each mate search computes one row of distances, of populationSize calls, on the thread breeding
+int distanceCalls = 0;
+std::atomic<int> searches{0};
+std::atomic<bool> searching{false};
+std::atomic<int> handedInWhileSearching{0};
+
+///A genetic distance slow enough for children to finish development while a mate is searched for, which tells when each search starts and ends
+uint64_t slowGeneticDistance(const Genome_t &first, const Genome_t &second){
+    if(distanceCalls++%populationSize==0){
+        ++searches;
+        searching = true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(4));
+    if(distanceCalls%populationSize==0){
+        searching = false;
+    }
+    return myGeneticDistance(first, second);
+}
+
+///Counts the bodies a pool thread starts measuring during the same mate search its previous one ended in, which it can only do if it handed that child in meanwhile
+TestTargets extractCellsDuringSearches(Body *body){
+    thread_local int endedInSearch = -1;
+    int search = searches;
+    handedInWhileSearching += searching && search==endedInSearch;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    endedInSearch = searching ? int(searches) : -1;
+    return TestTargets{body->cellsNumber/1000.f};
+}
+
+///@returns Whether children bred in steady state are handed in while the next mate is searched for, with more children in flight than threads to measure them
+bool handsInWhileSearching(SelectionPlan<TestWeights, TestTargets> plan, EvolutionSettings settings){
+    //Enough children for several mate searches to start with others in flight
+    plan.evaluationsPerRepeat = 6*populationSize;
+    settings.threads = 2;
+    settings.developmentDepth = 4;
+    distanceCalls = 0;
+    searches = 0;
+    handedInWhileSearching = 0;
+    Run measuredRun;
+    evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(measuredRun.genomes.data(), populationSize, developmentStages, measuredRun.bodies.bodies.data(), measuredRun.fitness.data(), plan, extractCellsDuringSearches, scoreCells, slowGeneticDistance, settings);
+    return handedInWhileSearching > 0;
+}
+
+std::string readFile(const std::string &path){
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+///Runs the first stage with a checkpoint, and resumes the whole plan from it, logging both as well as the uninterrupted run
+void checkResume(const Run &uninterrupted, const EvolutionSettings &serial, bool checkpointBodies, const char *name){
+    TestPlan test;
+    EvolutionSettings settings = serial;
+    settings.logPath = referenceLog;
+    Run logged;
+    run(&logged, test.plan, settings);
+    test.plan.number = 1;
+    settings.logPath = resumedLog;
+    settings.checkpointPath = checkpointPath;
+    settings.checkpointBodies = checkpointBodies;
+    Run firstStage;
+    run(&firstStage, test.plan, settings);
+    test.plan.number = 2;
+    settings.checkpointPath.clear();
+    settings.resumeFrom = checkpointPath;
+    Run resumed;
+    run(&resumed, test.plan, settings);
+    check(resumed==uninterrupted && logged==uninterrupted && readFile(resumedLog)==readFile(referenceLog), name);
+}
+
+int main(){
+    TestPlan test;
+    EvolutionSettings settings;
+    settings.printProgress = false;
+    settings.threads = 1;
+    settings.developmentDepth = 1;
+    Run serial;
+    run(&serial, test.plan, settings);
+    bool consistent = true;
+    for(int i=0;i<populationSize;++i){
+        consistent = consistent && developsInto<HeadlessBackend>(serial.genomes[i], developmentStages, serial.bodies.bodies[i], maxCells);
+        consistent = consistent && serial.fitness[i]==testFitness(&serial.bodies.bodies[i], test.plan.targets, test.stages[1].weights[0]);
+    }
+    check(consistent, "steady-state runs return matching genomes, bodies and fitnesses");
+    settings.threads = 4;
+    Run parallel;
+    run(&parallel, test.plan, settings);
+    settings.genomeCacheBudget = 0;
+    Run uncached;
+    run(&uncached, test.plan, settings);
+    check(parallel==serial && uncached==serial, "at depth 1, threads and the genome cache don't matter");
+    settings.genomeCacheBudget = EvolutionSettings().genomeCacheBudget;
+    settings.developmentDepth = 3;
+    Run deeper;
+    run(&deeper, test.plan, settings);
+    settings.threads = 1;
+    Run deeperSerial;
+    run(&deeperSerial, test.plan, settings);
+    settings.threads = 4;
+    settings.genomeCacheBudget = 0;
+    Run deeperUncached;
+    run(&deeperUncached, test.plan, settings);
+    settings.genomeCacheBudget = EvolutionSettings().genomeCacheBudget;
+    consistent = deeperSerial==deeper && deeperUncached==deeper;
+    for(int i=0;i<populationSize;++i){
+        consistent = consistent && developsInto<HeadlessBackend>(deeper.genomes[i], developmentStages, deeper.bodies.bodies[i], maxCells);
+    }
+    check(consistent, "at depth 3, threads and the genome cache don't matter either");
+    //One repeat is enough to see the children overlap
+    test.plan.number = 1;
+    test.stages[0].repeats = 1;
+    double serialSeconds, deeperSeconds;
+    int serialOverlap = mostScoredAtDepth(test.plan, settings, 1, &serialSeconds);
+    int deeperOverlap = mostScoredAtDepth(test.plan, settings, 4, &deeperSeconds);
+    std::printf("Seeded run measuring for 50ms each: %.3fs and up to %d at once at depth 1, %.3fs and up to %d at once at depth 4\n", serialSeconds, serialOverlap, deeperSeconds, deeperOverlap);
+    check(serialOverlap==1 && deeperOverlap > 1, "a deeper seeded run scores several children at once");
+    check(handsInWhileSearching(test.plan, settings), "children are handed in while the next mate is searched for");
+    test.plan.number = 2;
+    test.stages[0].repeats = 3;
+    //Unseeded runs do overlap development with scoring
+    test.plan.seed = 0;
+    settings.developmentDepth = 3;
+    Run overlapped;
+    run(&overlapped, test.plan, settings);
+    consistent = true;
+    for(int i=0;i<populationSize;++i){
+        consistent = consistent && developsInto<HeadlessBackend>(overlapped.genomes[i], developmentStages, overlapped.bodies.bodies[i], maxCells);
+        consistent = consistent && overlapped.fitness[i]==testFitness(&overlapped.bodies.bodies[i], test.plan.targets, test.stages[1].weights[0]);
+    }
+    check(consistent, "a deeper unseeded run returns matching results too");
+    test.plan.seed = 0x57ead;
+
+    //A stage without crossover or mutation can't breed anything
+    test.stages[1].substages.erase(test.stages[1].substages.begin() + 1, test.stages[1].substages.end());
+    test.stages[1].substages[0].individuals = populationSize;
+    Run invalid;
+    Run untouched;
+    std::streambuf *errors = std::cerr.rdbuf(nullptr);
+    bool rejected = !evolve<TestWeights, TestTargets, SparseBodyStorage, HeadlessBackend>(invalid.genomes.data(), populationSize, developmentStages, invalid.bodies.bodies.data(), invalid.fitness.data(), test.plan, testFitness, myGeneticDistance, settings);
+    std::cerr.rdbuf(errors);
+    check(rejected && invalid.fitness==untouched.fitness, "plans with nothing to breed are rejected before running");
+
+    settings.threads = 1;
+    settings.developmentDepth = 1;
+    checkResume(serial, settings, false, "a resumed run ends and logs like the uninterrupted one");
+    checkResume(serial, settings, true, "a run resumed with bodies ends and logs like it too");
+    std::remove(checkpointPath.c_str());
+    std::remove(referenceLog.c_str());
+    std::remove(resumedLog.c_str());
+    return testResult();
+}
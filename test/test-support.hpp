@@ -0,0 +1,111 @@
+#pragma once
+///@file test-support.hpp
+///@brief What the tests share: each test is an executable that runs its checks, prints one line per check and fails if any check did
+
+#include <evo-devo-gpu.hpp>
+#include <body-storage.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+///How many checks failed so far
+inline int &testFailures(){
+    static int failures = 0;
+    return failures;
+}
+
+///Prints the outcome of a check, and counts it if it failed
+inline void check(bool passed, const char *name){
+    std::printf("%-64s %s\n", name, passed ? "ok" : "FAILED");
+    std::fflush(stdout);
+    testFailures() += !passed;
+}
+
+///@returns What main() should return once all checks ran
+inline int testResult(){
+    return testFailures() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+///Targets and weights of testFitness
+struct TestTargets{
+    float cells;
+};
+
+struct TestWeights{
+    float cellsFactor;
+    float offset;
+
+    inline bool operator==(const TestWeights &rhs){
+        return cellsFactor==rhs.cellsFactor && offset==rhs.offset;
+    }
+    friend TestWeights operator+(TestWeights lhs, const TestWeights &rhs){
+        lhs.cellsFactor += rhs.cellsFactor;
+        lhs.offset += rhs.offset;
+        return lhs;
+    }
+    friend TestWeights operator*(TestWeights lhs, const int &rhs){
+        lhs.cellsFactor *= rhs;
+        lhs.offset *= rhs;
+        return lhs;
+    }
+};
+
+///Rewards bodies whose number of cells, in thousands, is close to targets.cells, and whose cells are of high types
+inline float testFitness(Body *body, const TestTargets &targets, const TestWeights &weights){
+    uint64_t types = 0;
+    for(uint64_t i=0;i<body->cellsNumber;++i){
+        types += body->cells[i].type;
+    }
+    return weights.cellsFactor * std::exp(-std::fabs(body->cellsNumber/1000.f - targets.cells)) + weights.offset + types*1e-6f;
+}
+
+///@returns A genome filled from a fixed sequence, which only depends on seed and index
+inline Genome_t testGenome(uint32_t seed, uint32_t index){
+    Genome_t genome;
+    uint64_t state = (uint64_t(seed) << 32 | index) * 0x9E3779B97F4A7C15ull + 1;
+    for(size_t b=0;b<sizeof(Genome_t);++b){
+        //xorshift64*
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        ((uint8_t*) &genome)[b] = (state * 0x2545F4914F6CDD1Dull) >> 56;
+    }
+    return genome;
+}
+
+///The bodies evolve() writes its last generation to, each with room for capacity cells
+struct TestBodies{
+    std::vector<std::vector<Cell>> cells;
+    std::vector<Body> bodies;
+
+    TestBodies(int populationSize, uint64_t capacity) : cells(populationSize, std::vector<Cell>(capacity)), bodies(populationSize){
+        for(int i=0;i<populationSize;++i){
+            bodies[i].cells = cells[i].data();
+            bodies[i].cellsNumber = 0;
+        }
+    }
+};
+
+inline bool sameBody(const Body &first, const Body &second){
+    return first.cellsNumber==second.cellsNumber && !std::memcmp(first.cells, second.cells, first.cellsNumber*sizeof(Cell));
+}
+
+///@returns Whether body is what genome develops into on a fresh backend, with room for capacity cells
+template<class Backend>
+bool developsInto(Genome_t genome, int developmentStages, const Body &body, uint64_t capacity){
+    Backend backend;
+    backend.initialize();
+    std::vector<uint8_t> grid(bodyGridVolume);
+    backend.load(&genome);
+    backend.develop(developmentStages);
+    backend.birth(grid.data());
+    backend.release();
+    std::vector<Cell> cells(capacity);
+    Body expected;
+    expected.cells = cells.data();
+    isolateBody(&expected, grid.data());
+    return sameBody(expected, body);
+}